@@ -0,0 +1,124 @@
+# Generates src/wynnkeyhash.h
+#
+# Builds a perfect hash for every json key of the requirements, base and identifications
+# sections from the name tables in src/wynnitems.h, mapping each key to its idArray index.
+# Run again whenever wynnItemReqsNames, wynnItemBaseNames or wynnItemIdNames change
+# (debug builds check the table against wynnitems.h on load).
+
+HEADER_IN = "src/wynnitems.h"
+HEADER_OUT = "src/wynnkeyhash.h"
+
+# Identification keys whose json spelling differs from wynnItemIdNames
+JSON_ALIASES = {
+    "1stSpellCost": "spellCost1st",
+    "2ndSpellCost": "spellCost2nd",
+    "3rdSpellCost": "spellCost3rd",
+    "4thSpellCost": "spellCost4th",
+    "raw1stSpellCost": "rawSpellCost1st",
+    "raw2ndSpellCost": "rawSpellCost2nd",
+    "raw3rdSpellCost": "rawSpellCost3rd",
+    "raw4thSpellCost": "rawSpellCost4th",
+}
+
+##############################################################################
+# Code
+#
+#
+##############################################################################
+
+import re
+
+FNV_PRIME = 16777619
+
+
+def keyhash(seed, key):
+    # Must match wynnitem_keyhash in src/itemloader.c
+    h = seed
+    for b in key.encode():
+        h ^= b
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h ^ (h >> 15)
+
+
+def read_names(source, array_name):
+    match = re.search(array_name + r"\[\]\s*=\s*\{(.*?)\};", source, re.S)
+    if not match:
+        print("Name table not found!", array_name)
+        exit(1)
+    return re.findall(r'"([^"]*)"', match.group(1))
+
+
+def find_seed(keys, bits):
+    mask = (1 << bits) - 1
+    for seed in range(0x811C9DC5, 0x811C9DC5 + 1000000):
+        slots = set()
+        for key in keys:
+            slot = keyhash(seed, key) & mask
+            if slot in slots:
+                break
+            slots.add(slot)
+        else:
+            return seed
+    print("No perfect hash seed found, increase the table bits!", bits)
+    exit(1)
+
+
+def make_section(name, keys, bits):
+    seed = find_seed([key for key, _ in keys], bits)
+    mask = (1 << bits) - 1
+
+    lines = []
+    lines.append(f"#define WYNNITEM_KEYHASH_{name.upper()}_BITS {bits}")
+    lines.append(f"#define WYNNITEM_KEYHASH_{name.upper()}_SEED 0x{seed:08X}u")
+    lines.append("")
+    lines.append(f"static const struct wynnitem_keyhash_entry wynnItem{name}KeyEntries[] = {{")
+    for key, index in keys:
+        lines.append(f'    {{"{key}", {len(key)}, {index}}},')
+    lines.append("};")
+    lines.append("")
+    lines.append(f"// Slot to entry index + 1 (0 is an empty slot)")
+    lines.append(f"static const uint8_t wynnItem{name}KeySlots[1 << WYNNITEM_KEYHASH_{name.upper()}_BITS] = {{")
+    for entry, (key, _) in enumerate(keys):
+        lines.append(f"    [{keyhash(seed, key) & mask}] = {entry + 1},")
+    lines.append("};")
+    lines.append("")
+    return lines
+
+
+if __name__ == "__main__":
+    with open(HEADER_IN, "r") as file:
+        source = file.read()
+
+    reqs = read_names(source, "wynnItemReqsNames")
+    base = read_names(source, "wynnItemBaseNames")
+    ids = read_names(source, "wynnItemIdNames")
+
+    reqs_keys = [(key, i) for i, key in enumerate(reqs)]
+    base_keys = [(key, len(reqs) + i) for i, key in enumerate(base)]
+    ids_offset = len(reqs) + len(base)
+    ids_keys = [(key, ids_offset + i) for i, key in enumerate(ids)]
+    ids_keys += [(alias, ids_offset + ids.index(name)) for alias, name in JSON_ALIASES.items()]
+
+    lines = []
+    lines.append("// Generated by gen_keyhash.py from the name tables in wynnitems.h. Do not edit.")
+    lines.append("#ifndef WYNNKEYHASH_H")
+    lines.append("#define WYNNKEYHASH_H")
+    lines.append("")
+    lines.append("#include <stdint.h>")
+    lines.append("")
+    lines.append("struct wynnitem_keyhash_entry")
+    lines.append("{")
+    lines.append("    const char* key;")
+    lines.append("    uint8_t length;")
+    lines.append("    uint8_t index;")
+    lines.append("};")
+    lines.append("")
+    lines += make_section("Reqs", reqs_keys, 5)
+    lines += make_section("Base", base_keys, 7)
+    lines += make_section("Ids", ids_keys, 10)
+    lines.append("#endif // WYNNKEYHASH_H")
+
+    with open(HEADER_OUT, "w") as file:
+        file.write("\n".join(lines) + "\n")
+
+    print("+ " + HEADER_OUT)
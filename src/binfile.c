@@ -0,0 +1,37 @@
+#include "binfile.h"
+#include <LTK/dataio.h>
+#include <LTK/error_handling.h>
+#include <stdio.h>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#endif
+
+uint64_t bin_hash(uint64_t hash, const void* pData, size_t size)
+{
+    const uint8_t* pBytes = pData;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+bool bin_file_replace(const char* path, uint8_t* pData, size_t size)
+{
+    char tmpPath[FILENAME_MAX];
+    ERR_RET(snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath), ERR_INVALID_ARGS, false);
+    dataio_write(tmpPath, pData, size);
+
+#ifdef PLATFORM_WINDOWS
+    // Fails while the old file is mapped, Windows can't replace a file with a view open
+    bool isReplaced = MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool isReplaced = rename(tmpPath, path) == 0;
+#endif
+    if (!isReplaced)
+        remove(tmpPath);
+
+    return isReplaced;
+}
@@ -0,0 +1,23 @@
+#ifndef BINFILE_H
+#define BINFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Helpers shared by the cache files written next to each other in data/
+
+#define BIN_HASH_SEED 0xCBF29CE484222325ULL
+
+/// @brief FNV-1a, chains from BIN_HASH_SEED or the hash of the previous buffer
+uint64_t bin_hash(uint64_t hash, const void* pData, size_t size);
+
+/// @brief Writes next to a file and swaps it in, so nobody reads a half written file and a
+//  mapping of the old file keeps its pages
+/// @param[in] path File to replace
+/// @param[in] pData New contents
+/// @param size Bytes of pData
+/// @return FALSE if the file couldn't be replaced, it is left as it was
+bool bin_file_replace(const char* path, uint8_t* pData, size_t size);
+
+#endif // BINFILE_H
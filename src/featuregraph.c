@@ -0,0 +1,658 @@
+#include "featuregraph.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <LTK/threading.h>
+#include <LTK/error_handling.h>
+
+// Nodes inserted per task of a build
+#define FEATURE_GRAPH_BUILD_CHUNK 32
+
+struct graph_candidate
+{
+    float distance;     // Squared
+    uint32_t node;
+};
+
+struct feature_graph_header
+{
+    uint64_t fingerprint;
+    uint32_t count;
+    uint32_t M;
+    uint32_t efConstruction;
+    uint32_t entry;
+    uint32_t topLevel;
+    uint32_t linkCount;
+};
+
+// Query compressed to its non zero features, |q - p|^2 = |q|^2 + |p|^2 - 2 q.p like the feature
+// scan, so a distance only reads the few stats the query has
+struct graph_query
+{
+    float norm;
+    size_t columnCount;
+    uint32_t columns[WYNNITEM_ID_ARRAY_SIZE];
+    float weights[WYNNITEM_ID_ARRAY_SIZE];
+};
+
+// Search state, one per thread
+struct graph_search
+{
+    uint64_t* pVisited;                     // Bit per node reached by the current layer search
+    struct graph_candidate* pCandidates;    // Closest first heap of nodes left to expand
+    struct graph_candidate* pResults;       // Furthest first heap of the ef closest so far
+    struct graph_candidate* pEntries;       // Sorted results of the layer above
+    struct graph_candidate* pScratch;       // Links of one node being merged or reselected
+    uint32_t* pLinks;                       // Copy of one link block
+    uint32_t* pSelected;
+};
+
+struct feature_graph_build
+{
+    FeatureGraph* pGraph;
+    Mutex* pLocks;      // One per node, held while its link blocks are read or written
+    Mutex entryLock;    // Held while the entry is read, and by an insert that raises the top layer
+    bool isFailed;
+};
+
+static inline const float* graph_point(FeatureGraph* pGraph, uint32_t node)
+{
+    return pGraph->pPoints + (size_t)node * WYNNITEM_FEATURE_POINT_SIZE;
+}
+
+static void graph_query_create(const float* pFeatures, struct graph_query* pQueryOut)
+{
+    pQueryOut->norm = 0.f;
+    pQueryOut->columnCount = 0;
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        pQueryOut->norm += pFeatures[i] * pFeatures[i];
+        if (pFeatures[i] == 0.f) continue;
+
+        pQueryOut->columns[pQueryOut->columnCount] = (uint32_t)i;
+        pQueryOut->weights[pQueryOut->columnCount++] = -2.f * pFeatures[i];
+    }
+}
+
+static inline float graph_query_distance(FeatureGraph* pGraph, const struct graph_query* pQuery, uint32_t node)
+{
+    const float* pPoint = graph_point(pGraph, node);
+    float distance = pQuery->norm + pGraph->pNorms[node];
+    for (size_t c = 0; c < pQuery->columnCount; c++) distance += pQuery->weights[c] * pPoint[pQuery->columns[c]];
+    return distance > 0.f ? distance : 0.f;
+}
+
+static inline uint32_t* graph_links(FeatureGraph* pGraph, uint32_t node, uint32_t level)
+{
+    uint32_t* pBlock = pGraph->pLinks + pGraph->pLinkOffsets[node];
+    return level == 0 ? pBlock : pBlock + 1 + 2 * pGraph->M + (level - 1) * (1 + pGraph->M);
+}
+
+static inline uint32_t graph_max_links(FeatureGraph* pGraph, uint32_t level)
+{
+    return level == 0 ? 2 * pGraph->M : pGraph->M;
+}
+
+// Links stay 4 byte aligned behind the levels
+static inline size_t graph_levels_size(uint32_t count)
+{
+    return ((size_t)count + 3) & ~(size_t)3;
+}
+
+static inline uint64_t graph_hash(uint64_t hash, uint64_t value)
+{
+    hash ^= value;
+    hash *= 0x100000001B3ULL;
+    return hash ^ (hash >> 32);
+}
+
+// Same levels on every build of the same table, so builds only differ by thread timing
+static uint32_t graph_node_level(uint32_t node, uint32_t M)
+{
+    uint64_t x = ((uint64_t)node + 1) * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 31)) * 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 29;
+    double uniform = (double)((x >> 11) + 1) / 9007199254740992.0;    // (0, 1]
+    double level = -log(uniform) / log((double)M);
+    return level < FEATURE_GRAPH_MAX_LEVEL ? (uint32_t)level : FEATURE_GRAPH_MAX_LEVEL;
+}
+
+// Closest first when isMax is FALSE, furthest first otherwise
+static inline bool candidate_above(struct graph_candidate a, struct graph_candidate b, bool isMax)
+{
+    return isMax ? a.distance > b.distance : a.distance < b.distance;
+}
+
+static void candidate_push(struct graph_candidate* pHeap, size_t* pSize, struct graph_candidate candidate, bool isMax)
+{
+    size_t i = (*pSize)++;
+    while (i > 0 && candidate_above(candidate, pHeap[(i - 1) / 2], isMax))
+    {
+        pHeap[i] = pHeap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    pHeap[i] = candidate;
+}
+
+static struct graph_candidate candidate_pop(struct graph_candidate* pHeap, size_t* pSize, bool isMax)
+{
+    struct graph_candidate top = pHeap[0];
+    struct graph_candidate last = pHeap[--(*pSize)];
+    size_t i = 0;
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= *pSize) break;
+        if (child + 1 < *pSize && candidate_above(pHeap[child + 1], pHeap[child], isMax)) child++;
+        if (!candidate_above(pHeap[child], last, isMax)) break;
+        pHeap[i] = pHeap[child];
+        i = child;
+    }
+    pHeap[i] = last;
+    return top;
+}
+
+static void graph_search_destroy(struct graph_search* pSearch)
+{
+    free(pSearch->pVisited);
+    free(pSearch->pCandidates);
+    free(pSearch->pResults);
+    free(pSearch->pEntries);
+    free(pSearch->pScratch);
+    free(pSearch->pLinks);
+    free(pSearch->pSelected);
+    *pSearch = (struct graph_search){0};
+}
+
+static bool graph_search_create(struct graph_search* pSearch, FeatureGraph* pGraph, size_t ef)
+{
+    // Every node gets into the candidates at most once, the results take one more than ef before
+    // the furthest is dropped and a link block takes one more link, or the M links of an insert,
+    // before it is reselected
+    *pSearch = (struct graph_search){0};
+    pSearch->pVisited = malloc(((size_t)pGraph->count + 63) / 64 * sizeof(uint64_t));
+    pSearch->pCandidates = malloc(pGraph->count * sizeof(struct graph_candidate));
+    pSearch->pResults = malloc((ef + 1) * sizeof(struct graph_candidate));
+    pSearch->pEntries = malloc(ef * sizeof(struct graph_candidate));
+    pSearch->pScratch = malloc(3 * pGraph->M * sizeof(struct graph_candidate));
+    pSearch->pLinks = malloc(2 * pGraph->M * sizeof(uint32_t));
+    pSearch->pSelected = malloc(pGraph->M * sizeof(uint32_t));
+    if (pSearch->pVisited == NULL || pSearch->pCandidates == NULL || pSearch->pResults == NULL ||
+        pSearch->pEntries == NULL || pSearch->pScratch == NULL || pSearch->pLinks == NULL || pSearch->pSelected == NULL)
+    {
+        graph_search_destroy(pSearch);
+        ERR_RET(true, ERR_FAILURE, false);
+    }
+    return true;
+}
+
+// Copies a link block, under the node lock while the graph is being built
+static uint32_t graph_read_links(FeatureGraph* pGraph, Mutex* pLocks, uint32_t node, uint32_t level, uint32_t* pOut)
+{
+    if (pLocks != NULL) mutex_lock(&pLocks[node]);
+    uint32_t* pBlock = graph_links(pGraph, node, level);
+    uint32_t count = pBlock[0];
+    memcpy(pOut, pBlock + 1, count * sizeof(uint32_t));
+    if (pLocks != NULL) mutex_unlock(&pLocks[node]);
+    return count;
+}
+
+// Greedy walk from the entry down to the layer above toLevel, one closest node per layer
+static struct graph_candidate graph_descend(
+    FeatureGraph* pGraph,
+    Mutex* pLocks,
+    struct graph_search* pSearch,
+    const struct graph_query* pQuery,
+    uint32_t entry,
+    uint32_t fromLevel,
+    uint32_t toLevel)
+{
+    struct graph_candidate current = {graph_query_distance(pGraph, pQuery, entry), entry};
+    for (uint32_t level = fromLevel; level > toLevel; level--)
+    {
+        for (bool isCloser = true; isCloser;)
+        {
+            isCloser = false;
+            uint32_t linkCount = graph_read_links(pGraph, pLocks, current.node, level, pSearch->pLinks);
+            for (uint32_t i = 0; i < linkCount; i++)
+            {
+                float distance = graph_query_distance(pGraph, pQuery, pSearch->pLinks[i]);
+                if (distance >= current.distance) continue;
+                current = (struct graph_candidate){distance, pSearch->pLinks[i]};
+                isCloser = true;
+            }
+        }
+    }
+    return current;
+}
+
+// The ef closest nodes to a query on one layer reachable from the entries, written to pEntries
+// closest first
+static size_t graph_search_layer(
+    FeatureGraph* pGraph,
+    Mutex* pLocks,
+    struct graph_search* pSearch,
+    const struct graph_query* pQuery,
+    size_t entryCount,
+    size_t ef,
+    uint32_t level)
+{
+    memset(pSearch->pVisited, 0, ((size_t)pGraph->count + 63) / 64 * sizeof(uint64_t));
+    size_t candidateCount = 0, resultCount = 0;
+    for (size_t i = 0; i < entryCount; i++)
+    {
+        uint32_t node = pSearch->pEntries[i].node;
+        pSearch->pVisited[node / 64] |= 1ULL << (node % 64);
+        candidate_push(pSearch->pCandidates, &candidateCount, pSearch->pEntries[i], false);
+        candidate_push(pSearch->pResults, &resultCount, pSearch->pEntries[i], true);
+        if (resultCount > ef) candidate_pop(pSearch->pResults, &resultCount, true);
+    }
+
+    while (candidateCount > 0)
+    {
+        // Nothing left to expand is closer than the furthest result
+        struct graph_candidate candidate = candidate_pop(pSearch->pCandidates, &candidateCount, false);
+        if (resultCount >= ef && candidate.distance > pSearch->pResults[0].distance) break;
+
+        uint32_t linkCount = graph_read_links(pGraph, pLocks, candidate.node, level, pSearch->pLinks);
+        for (uint32_t i = 0; i < linkCount; i++)
+        {
+            uint32_t node = pSearch->pLinks[i];
+            if (pSearch->pVisited[node / 64] >> (node % 64) & 1) continue;
+            pSearch->pVisited[node / 64] |= 1ULL << (node % 64);
+
+            float distance = graph_query_distance(pGraph, pQuery, node);
+            if (resultCount >= ef && distance >= pSearch->pResults[0].distance) continue;
+
+            struct graph_candidate neighbour = {distance, node};
+            candidate_push(pSearch->pCandidates, &candidateCount, neighbour, false);
+            candidate_push(pSearch->pResults, &resultCount, neighbour, true);
+            if (resultCount > ef) candidate_pop(pSearch->pResults, &resultCount, true);
+        }
+    }
+
+    size_t foundCount = resultCount;
+    for (size_t i = foundCount; i > 0; i--) pSearch->pEntries[i - 1] = candidate_pop(pSearch->pResults, &resultCount, true);
+    return foundCount;
+}
+
+// Picks up to maxLinks of the candidates (closest first) for a point, skipping any closer to one
+// already picked than to the point, so the links spread out instead of bunching up on one side
+static uint32_t graph_select_links(
+    FeatureGraph* pGraph,
+    const struct graph_candidate* pSorted,
+    size_t count,
+    uint32_t maxLinks,
+    uint32_t* pOut)
+{
+    uint32_t selectedCount = 0;
+    for (size_t i = 0; i < count && selectedCount < maxLinks; i++)
+    {
+        const float* pPoint = graph_point(pGraph, pSorted[i].node);
+        bool isKept = true;
+        for (uint32_t j = 0; j < selectedCount && isKept; j++)
+        {
+            isKept = wynnitem_point_distance_sqrd(pPoint, graph_point(pGraph, pOut[j])) >= pSorted[i].distance;
+        }
+        if (isKept) pOut[selectedCount++] = pSorted[i].node;
+    }
+    return selectedCount;
+}
+
+// Sorts the scratch links closest to a point first and keeps maxLinks of them in a link block
+static void graph_reselect_links(
+    FeatureGraph* pGraph,
+    struct graph_search* pSearch,
+    uint32_t node,
+    size_t count,
+    uint32_t maxLinks,
+    uint32_t* pBlock)
+{
+    const float* pPoint = graph_point(pGraph, node);
+    for (size_t i = 0; i < count; i++)
+    {
+        struct graph_candidate candidate = pSearch->pScratch[i];
+        candidate.distance = wynnitem_point_distance_sqrd(pPoint, graph_point(pGraph, candidate.node));
+        size_t j = i;
+        for (; j > 0 && pSearch->pScratch[j - 1].distance > candidate.distance; j--) pSearch->pScratch[j] = pSearch->pScratch[j - 1];
+        pSearch->pScratch[j] = candidate;
+    }
+    pBlock[0] = graph_select_links(pGraph, pSearch->pScratch, count, maxLinks, pBlock + 1);
+}
+
+// Links node from neighbour, reselecting the links of neighbour if it has no room left
+static void graph_add_link(
+    FeatureGraph* pGraph,
+    Mutex* pLocks,
+    struct graph_search* pSearch,
+    uint32_t neighbour,
+    uint32_t node,
+    uint32_t level)
+{
+    uint32_t maxLinks = graph_max_links(pGraph, level);
+    if (pLocks != NULL) mutex_lock(&pLocks[neighbour]);
+
+    uint32_t* pBlock = graph_links(pGraph, neighbour, level);
+    if (pBlock[0] < maxLinks)
+        pBlock[1 + pBlock[0]++] = node;
+    else
+    {
+        for (uint32_t i = 0; i < pBlock[0]; i++) pSearch->pScratch[i] = (struct graph_candidate){0.f, pBlock[1 + i]};
+        pSearch->pScratch[pBlock[0]] = (struct graph_candidate){0.f, node};
+        graph_reselect_links(pGraph, pSearch, neighbour, pBlock[0] + 1, maxLinks, pBlock);
+    }
+
+    if (pLocks != NULL) mutex_unlock(&pLocks[neighbour]);
+}
+
+// Writes the links an insert selected for its node. Other inserts can link back to the node while
+// it searches the layers below, those links are merged in instead of overwritten.
+static void graph_set_links(
+    FeatureGraph* pGraph,
+    Mutex* pLocks,
+    struct graph_search* pSearch,
+    uint32_t node,
+    uint32_t level,
+    uint32_t selectedCount)
+{
+    mutex_lock(&pLocks[node]);
+    uint32_t* pBlock = graph_links(pGraph, node, level);
+    if (pBlock[0] == 0)
+    {
+        pBlock[0] = selectedCount;
+        memcpy(pBlock + 1, pSearch->pSelected, selectedCount * sizeof(uint32_t));
+    }
+    else
+    {
+        size_t count = 0;
+        for (uint32_t i = 0; i < pBlock[0] + selectedCount; i++)
+        {
+            uint32_t linked = i < pBlock[0] ? pBlock[1 + i] : pSearch->pSelected[i - pBlock[0]];
+            bool isLinked = false;
+            for (size_t j = 0; j < count && !isLinked; j++) isLinked = pSearch->pScratch[j].node == linked;
+            if (!isLinked) pSearch->pScratch[count++] = (struct graph_candidate){0.f, linked};
+        }
+
+        uint32_t maxLinks = graph_max_links(pGraph, level);
+        if (count <= maxLinks)
+        {
+            for (size_t i = 0; i < count; i++) pBlock[1 + i] = pSearch->pScratch[i].node;
+            pBlock[0] = (uint32_t)count;
+        }
+        else
+            graph_reselect_links(pGraph, pSearch, node, count, maxLinks, pBlock);
+    }
+    mutex_unlock(&pLocks[node]);
+}
+
+static void graph_insert(struct feature_graph_build* pBuild, struct graph_search* pSearch, uint32_t node)
+{
+    FeatureGraph* pGraph = pBuild->pGraph;
+    struct graph_query query;
+    graph_query_create(graph_point(pGraph, node), &query);
+    uint32_t level = pGraph->pLevels[node];
+
+    // A node above the top layer becomes the entry, other inserts wait until it is linked in
+    mutex_lock(&pBuild->entryLock);
+    uint32_t entry = pGraph->entry;
+    uint32_t topLevel = pGraph->topLevel;
+    bool isNewTop = level > topLevel;
+    if (!isNewTop) mutex_unlock(&pBuild->entryLock);
+
+    uint32_t startLevel = level < topLevel ? level : topLevel;
+    pSearch->pEntries[0] = graph_descend(pGraph, pBuild->pLocks, pSearch, &query, entry, topLevel, startLevel);
+    size_t entryCount = 1;
+    for (uint32_t layer = startLevel + 1; layer-- > 0;)
+    {
+        // The candidates of this layer are the entries of the one below
+        entryCount = graph_search_layer(pGraph, pBuild->pLocks, pSearch, &query, entryCount, pGraph->efConstruction, layer);
+        uint32_t selectedCount = graph_select_links(pGraph, pSearch->pEntries, entryCount, pGraph->M, pSearch->pSelected);
+
+        graph_set_links(pGraph, pBuild->pLocks, pSearch, node, layer, selectedCount);
+
+        for (uint32_t i = 0; i < selectedCount; i++)
+            graph_add_link(pGraph, pBuild->pLocks, pSearch, pSearch->pSelected[i], node, layer);
+    }
+
+    if (isNewTop)
+    {
+        pGraph->entry = node;
+        pGraph->topLevel = level;
+        mutex_unlock(&pBuild->entryLock);
+    }
+}
+
+static void graph_insert_task(void* pArgs, size_t task)
+{
+    struct feature_graph_build* pBuild = pArgs;
+    FeatureGraph* pGraph = pBuild->pGraph;
+
+    struct graph_search search;
+    if (!graph_search_create(&search, pGraph, pGraph->efConstruction))
+    {
+        pBuild->isFailed = true;
+        return;
+    }
+
+    // Node 0 is the first entry and already in
+    size_t first = 1 + task * FEATURE_GRAPH_BUILD_CHUNK;
+    size_t end = first + FEATURE_GRAPH_BUILD_CHUNK < pGraph->count ? first + FEATURE_GRAPH_BUILD_CHUNK : pGraph->count;
+    for (size_t node = first; node < end; node++) graph_insert(pBuild, &search, (uint32_t)node);
+
+    graph_search_destroy(&search);
+}
+
+// Link blocks of every node from its level, pLevels has to be set
+static bool graph_alloc(FeatureGraph* pGraph, WynnItemStatTable* pTable)
+{
+    pGraph->pLinkOffsets = malloc(pGraph->count * sizeof(uint32_t));
+    pGraph->pPoints = calloc((size_t)pGraph->count * WYNNITEM_FEATURE_POINT_SIZE, sizeof(float));
+    pGraph->pNorms = malloc(pGraph->count * sizeof(float));
+    ERR_RET(pGraph->pLinkOffsets == NULL || pGraph->pPoints == NULL || pGraph->pNorms == NULL, ERR_FAILURE, false);
+
+    size_t linkCount = 0;
+    for (uint32_t node = 0; node < pGraph->count; node++)
+    {
+        pGraph->pLinkOffsets[node] = (uint32_t)linkCount;
+        linkCount += 1 + 2 * pGraph->M + (size_t)pGraph->pLevels[node] * (1 + pGraph->M);
+    }
+    ERR_RET(linkCount > UINT32_MAX, ERR_FAILURE, false);
+    pGraph->linkCount = (uint32_t)linkCount;
+    pGraph->pLinks = calloc(linkCount, sizeof(uint32_t));
+    ERR_RET(pGraph->pLinks == NULL, ERR_FAILURE, false);
+
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        float* pColumn = wynnitem_feature_column(pTable, i);
+        for (uint32_t row = 0; row < pGraph->count; row++) pGraph->pPoints[(size_t)row * WYNNITEM_FEATURE_POINT_SIZE + i] = pColumn[row];
+    }
+    memcpy(pGraph->pNorms, pTable->pFeatureNorms, pGraph->count * sizeof(float));
+    return true;
+}
+
+uint64_t feature_graph_fingerprint(WynnItemStatTable* pTable, FeatureGraphParams params)
+{
+    uint64_t hash = wynnitem_feature_fingerprint(pTable);
+    hash = graph_hash(hash, params.M);
+    return graph_hash(hash, params.efConstruction);
+}
+
+FeatureGraph feature_graph_create(WynnItemStatTable* pTable, FeatureGraphParams params, WorkerPool* pPool)
+{
+    FeatureGraph graph = {0};
+    ERR_RET(params.M < 2 || params.efConstruction == 0, ERR_INVALID_ARGS, graph);
+    graph.count = (uint32_t)pTable->count;
+    graph.M = params.M;
+    graph.efConstruction = params.efConstruction;
+    graph.fingerprint = feature_graph_fingerprint(pTable, params);
+    // Searches of an empty graph find nothing without touching its arrays
+    if (graph.count == 0) return graph;
+
+    graph.pLevels = malloc(graph.count);
+    ERR_RET(graph.pLevels == NULL, ERR_FAILURE, (FeatureGraph){0});
+    for (uint32_t node = 0; node < graph.count; node++) graph.pLevels[node] = (uint8_t)graph_node_level(node, graph.M);
+    if (!graph_alloc(&graph, pTable))
+    {
+        feature_graph_destroy(&graph);
+        return graph;
+    }
+
+    struct feature_graph_build build = {&graph, malloc(graph.count * sizeof(Mutex)), mutex_create(), false};
+    if (build.pLocks == NULL)
+    {
+        mutex_destroy(&build.entryLock);
+        feature_graph_destroy(&graph);
+        ERR_RET(true, ERR_FAILURE, graph);
+    }
+    for (uint32_t node = 0; node < graph.count; node++) build.pLocks[node] = mutex_create();
+
+    graph.entry = 0;
+    graph.topLevel = graph.pLevels[0];
+    size_t taskCount = (graph.count - 1 + FEATURE_GRAPH_BUILD_CHUNK - 1) / FEATURE_GRAPH_BUILD_CHUNK;
+    if (pPool != NULL)
+        worker_pool_run(pPool, graph_insert_task, &build, taskCount);
+    else
+    {
+        for (size_t task = 0; task < taskCount; task++) graph_insert_task(&build, task);
+    }
+
+    for (uint32_t node = 0; node < graph.count; node++) mutex_destroy(&build.pLocks[node]);
+    free(build.pLocks);
+    mutex_destroy(&build.entryLock);
+    if (build.isFailed)
+    {
+        feature_graph_destroy(&graph);
+        ERR_RET(true, ERR_FAILURE, graph);
+    }
+
+    return graph;
+}
+
+void feature_graph_destroy(FeatureGraph* pGraph)
+{
+    free(pGraph->pLevels);
+    free(pGraph->pLinkOffsets);
+    free(pGraph->pLinks);
+    free(pGraph->pPoints);
+    free(pGraph->pNorms);
+    *pGraph = (FeatureGraph){0};
+}
+
+size_t feature_graph_size(FeatureGraph* pGraph)
+{
+    return sizeof(struct feature_graph_header) + graph_levels_size(pGraph->count) + (size_t)pGraph->linkCount * sizeof(uint32_t);
+}
+
+void feature_graph_serialize(FeatureGraph* pGraph, uint8_t* pOut)
+{
+    struct feature_graph_header header = {
+        pGraph->fingerprint, pGraph->count, pGraph->M, pGraph->efConstruction,
+        pGraph->entry, pGraph->topLevel, pGraph->linkCount
+    };
+    memcpy(pOut, &header, sizeof(header));
+    if (pGraph->count == 0) return;
+
+    pOut += sizeof(header);
+    memset(pOut, 0, graph_levels_size(pGraph->count));
+    memcpy(pOut, pGraph->pLevels, pGraph->count);
+    pOut += graph_levels_size(pGraph->count);
+    memcpy(pOut, pGraph->pLinks, (size_t)pGraph->linkCount * sizeof(uint32_t));
+}
+
+// Every link has to point at a node and every block has to fit, a search trusts both
+static bool graph_links_valid(FeatureGraph* pGraph)
+{
+    if (pGraph->count > 0 && (pGraph->entry >= pGraph->count || pGraph->pLevels[pGraph->entry] != pGraph->topLevel))
+        return false;
+
+    for (uint32_t node = 0; node < pGraph->count; node++)
+    {
+        if (pGraph->pLevels[node] > pGraph->topLevel) return false;
+        for (uint32_t level = 0; level <= pGraph->pLevels[node]; level++)
+        {
+            uint32_t* pBlock = graph_links(pGraph, node, level);
+            if (pBlock[0] > graph_max_links(pGraph, level)) return false;
+            for (uint32_t i = 0; i < pBlock[0]; i++)
+            {
+                if (pBlock[1 + i] >= pGraph->count) return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t feature_graph_load(const uint8_t* pData, size_t size, WynnItemStatTable* pTable, FeatureGraphParams params, FeatureGraph* pGraphOut)
+{
+    *pGraphOut = (FeatureGraph){0};
+    struct feature_graph_header header;
+    ERR_RET(pData == NULL || size < sizeof(header), ERR_PARSING, 0);
+    memcpy(&header, pData, sizeof(header));
+    ERR_RET(header.M < 2 || header.topLevel > FEATURE_GRAPH_MAX_LEVEL, ERR_PARSING, 0);
+
+    size_t graphSize = sizeof(header) + graph_levels_size(header.count) + (size_t)header.linkCount * sizeof(uint32_t);
+    ERR_RET(graphSize > size, ERR_PARSING, 0);
+
+    // A graph of other items or parameters is skipped, the caller builds a new one
+    if (header.count != pTable->count || header.M != params.M || header.efConstruction != params.efConstruction ||
+        header.fingerprint != feature_graph_fingerprint(pTable, params))
+        return graphSize;
+
+    FeatureGraph graph = {
+        .count = header.count,
+        .M = header.M,
+        .efConstruction = header.efConstruction,
+        .entry = header.entry,
+        .topLevel = header.topLevel,
+        .fingerprint = header.fingerprint,
+    };
+    if (graph.count == 0)
+    {
+        *pGraphOut = graph;
+        return graphSize;
+    }
+
+    graph.pLevels = malloc(graph.count);
+    ERR_RET(graph.pLevels == NULL, ERR_FAILURE, 0);
+    memcpy(graph.pLevels, pData + sizeof(header), graph.count);
+
+    bool isValid = true;
+    for (uint32_t node = 0; node < graph.count && isValid; node++) isValid = graph.pLevels[node] <= FEATURE_GRAPH_MAX_LEVEL;
+    isValid = isValid && graph_alloc(&graph, pTable) && graph.linkCount == header.linkCount;
+    if (isValid)
+    {
+        memcpy(graph.pLinks, pData + sizeof(header) + graph_levels_size(graph.count), (size_t)graph.linkCount * sizeof(uint32_t));
+        isValid = graph_links_valid(&graph);
+    }
+    if (!isValid)
+    {
+        feature_graph_destroy(&graph);
+        ERR_RET(true, ERR_PARSING, 0);
+    }
+
+    *pGraphOut = graph;
+    return graphSize;
+}
+
+size_t feature_graph_search(FeatureGraph* pGraph, const float* pFeatures, size_t k, size_t efSearch, uint32_t* pRowsOut, float* pDistancesOut)
+{
+    if (pGraph->count == 0 || k == 0) return 0;
+    size_t ef = efSearch > k ? efSearch : k;
+
+    struct graph_query query;
+    graph_query_create(pFeatures, &query);
+
+    struct graph_search search;
+    ERR_RET(!graph_search_create(&search, pGraph, ef), ERR_FAILURE, 0);
+    search.pEntries[0] = graph_descend(pGraph, NULL, &search, &query, pGraph->entry, pGraph->topLevel, 0);
+    size_t foundCount = graph_search_layer(pGraph, NULL, &search, &query, 1, ef, 0);
+
+    foundCount = foundCount < k ? foundCount : k;
+    for (size_t i = 0; i < foundCount; i++)
+    {
+        pRowsOut[i] = search.pEntries[i].node;
+        pDistancesOut[i] = sqrtf(search.pEntries[i].distance);
+    }
+    graph_search_destroy(&search);
+
+    return foundCount;
+}
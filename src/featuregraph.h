@@ -0,0 +1,86 @@
+#ifndef FEATUREGRAPH_H
+#define FEATUREGRAPH_H
+
+#include "wynnitems.h"
+#include "workerpool.h"
+
+// Links per node on the upper layers, layer 0 keeps twice as many
+#ifndef FEATURE_GRAPH_M
+#define FEATURE_GRAPH_M 16
+#endif
+// Candidates kept while linking a node in, more builds a better graph slower
+#ifndef FEATURE_GRAPH_EF_CONSTRUCTION
+#define FEATURE_GRAPH_EF_CONSTRUCTION 100
+#endif
+// Candidates kept while searching (never fewer than k), more finds the true neighbours more often
+#ifndef FEATURE_GRAPH_EF_SEARCH
+#define FEATURE_GRAPH_EF_SEARCH 48
+#endif
+#define FEATURE_GRAPH_MAX_LEVEL 15
+
+typedef struct
+{
+    uint32_t M;
+    uint32_t efConstruction;
+} FeatureGraphParams;
+
+#define FEATURE_GRAPH_PARAMS_DEFAULT (FeatureGraphParams){FEATURE_GRAPH_M, FEATURE_GRAPH_EF_CONSTRUCTION}
+
+// Hierarchical navigable small world graph over the feature rows of one stat table, nodes are
+// rows. Every node is on layer 0 and on every layer above with a 1 / M chance, each layer links
+// nodes to close ones picked so that they point in different directions. A search walks greedily
+// down from the top layer and keeps the efSearch closest nodes it meets on layer 0, so it is
+// approximate and misses a close row now and then (see wynnitems_graph_benchmark).
+typedef struct
+{
+    uint32_t count;
+    uint32_t M;
+    uint32_t efConstruction;
+    uint32_t entry;             // Node on the top layer
+    uint32_t topLevel;
+    uint64_t fingerprint;       // feature_graph_fingerprint of what the graph was built from
+    uint8_t* pLevels;           // Top layer of every node
+    uint32_t* pLinkOffsets;     // First link block of every node in pLinks
+    uint32_t* pLinks;           // Block per node and layer, a count then 2M links on layer 0 and M above
+    uint32_t linkCount;
+    float* pPoints;             // Features of every node, row major so a distance stays within one node
+    float* pNorms;              // Squared feature norm of every node
+} FeatureGraph;
+
+/// @brief Hash of the features of a table and the build parameters, a graph is only valid for
+//  a table with the same fingerprint
+uint64_t feature_graph_fingerprint(WynnItemStatTable* pTable, FeatureGraphParams params);
+
+/// @brief Links every row of a table into a new graph
+/// @param[in] pTable Table with features
+/// @param params Build parameters
+/// @param[in] pPool Workers to insert rows on, NULL inserts on the calling thread
+/// @return Graph, destroy with feature_graph_destroy
+FeatureGraph feature_graph_create(WynnItemStatTable* pTable, FeatureGraphParams params, WorkerPool* pPool);
+void feature_graph_destroy(FeatureGraph* pGraph);
+
+/// @brief Bytes feature_graph_serialize writes, the features aren't stored
+size_t feature_graph_size(FeatureGraph* pGraph);
+void feature_graph_serialize(FeatureGraph* pGraph, uint8_t* pOut);
+
+/// @brief Loads a serialized graph for a table
+/// @param[in] pData Serialized graph
+/// @param size Bytes of pData, may run past the graph
+/// @param[in] pTable Table the graph has to belong to, features are copied from it
+/// @param params Parameters the graph has to be built with
+/// @param[out] pGraphOut Graph
+/// @return Bytes read, 0 if pData isn't a graph. If it is one but for another table or other
+//  parameters pGraphOut is left empty
+size_t feature_graph_load(const uint8_t* pData, size_t size, WynnItemStatTable* pTable, FeatureGraphParams params, FeatureGraph* pGraphOut);
+
+/// @brief About the k rows closest to a query
+/// @param[in] pGraph Graph
+/// @param[in] pFeatures Query from wynnitem_features
+/// @param k Rows wanted
+/// @param efSearch Candidates kept, raised to k if lower
+/// @param[out] pRowsOut Up to k stat table rows, closest first
+/// @param[out] pDistancesOut Feature distance of every row
+/// @return Rows found
+size_t feature_graph_search(FeatureGraph* pGraph, const float* pFeatures, size_t k, size_t efSearch, uint32_t* pRowsOut, float* pDistancesOut);
+
+#endif // FEATUREGRAPH_H
@@ -0,0 +1,215 @@
+#include "featurematrix.h"
+#include "featurescan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <LTK/error_handling.h>
+
+struct feature_matrix_header
+{
+    uint64_t fingerprint;
+    uint32_t count;
+    uint32_t k;
+};
+
+struct feature_matrix_build
+{
+    FeatureMatrix* pMatrix;
+    WynnItemStatTable* pTable;
+    FeatureScanKernel kernel;
+    bool isFailed;
+};
+
+// Query rows compressed to their non zero features, like wynnitem_feature_scan
+struct feature_matrix_query
+{
+    float norm;
+    size_t columnCount;
+    const float* columns[WYNNITEM_ID_ARRAY_SIZE];
+    float weights[WYNNITEM_ID_ARRAY_SIZE];
+};
+
+static void feature_matrix_block_task(void* pArgs, size_t task)
+{
+    struct feature_matrix_build* pBuild = pArgs;
+    FeatureMatrix* pMatrix = pBuild->pMatrix;
+    WynnItemStatTable* pTable = pBuild->pTable;
+    size_t k = pMatrix->k;
+    size_t queryBegin = task * FEATURE_MATRIX_QUERY_BLOCK;
+    size_t queryEnd = queryBegin + FEATURE_MATRIX_QUERY_BLOCK < pMatrix->count ?
+        queryBegin + FEATURE_MATRIX_QUERY_BLOCK : pMatrix->count;
+
+    struct feature_matrix_query* pQueries = malloc(FEATURE_MATRIX_QUERY_BLOCK * sizeof(struct feature_matrix_query));
+    size_t counts[FEATURE_MATRIX_QUERY_BLOCK] = {0};
+    if (pQueries == NULL)
+    {
+        pBuild->isFailed = true;
+        return;
+    }
+    for (size_t query = queryBegin; query < queryEnd; query++)
+    {
+        struct feature_matrix_query* pQuery = &pQueries[query - queryBegin];
+        pQuery->norm = pTable->pFeatureNorms[query];
+        pQuery->columnCount = 0;
+        for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+        {
+            float feature = wynnitem_feature_column(pTable, i)[query];
+            if (feature == 0.f) continue;
+
+            pQuery->columns[pQuery->columnCount] = wynnitem_feature_column(pTable, i);
+            pQuery->weights[pQuery->columnCount++] = -2.f * feature;
+        }
+    }
+
+    // Squared distances until the end, the neighbours of a query go straight into its matrix row
+    const float* blockColumns[WYNNITEM_ID_ARRAY_SIZE];
+    float distances[FEATURE_MATRIX_ROW_BLOCK];
+    for (size_t blockBegin = 0; blockBegin < pMatrix->count; blockBegin += FEATURE_MATRIX_ROW_BLOCK)
+    {
+        size_t blockCount = pMatrix->count - blockBegin < FEATURE_MATRIX_ROW_BLOCK ?
+            pMatrix->count - blockBegin : FEATURE_MATRIX_ROW_BLOCK;
+        for (size_t query = queryBegin; query < queryEnd; query++)
+        {
+            struct feature_matrix_query* pQuery = &pQueries[query - queryBegin];
+            for (size_t c = 0; c < pQuery->columnCount; c++) blockColumns[c] = pQuery->columns[c] + blockBegin;
+            pBuild->kernel(
+                blockColumns, pQuery->weights, pQuery->columnCount,
+                pTable->pFeatureNorms + blockBegin, pQuery->norm, blockCount, distances
+            );
+
+            // Almost every row is further than the k-th, that test is all most rows cost
+            uint32_t* pRows = pMatrix->pRows + query * k;
+            float* pDistances = pMatrix->pDistances + query * k;
+            size_t count = counts[query - queryBegin];
+            float worst = count == k ? pDistances[k - 1] : INFINITY;
+            for (size_t i = 0; i < blockCount; i++)
+            {
+                if (distances[i] >= worst) continue;
+
+                size_t j = count < k ? count++ : k - 1;
+                for (; j > 0 && pDistances[j - 1] > distances[i]; j--)
+                {
+                    pRows[j] = pRows[j - 1];
+                    pDistances[j] = pDistances[j - 1];
+                }
+                pRows[j] = (uint32_t)(blockBegin + i);
+                pDistances[j] = distances[i];
+                if (count == k) worst = pDistances[k - 1];
+            }
+            counts[query - queryBegin] = count;
+        }
+    }
+
+    for (size_t query = queryBegin; query < queryEnd; query++)
+    {
+        float* pDistances = pMatrix->pDistances + query * k;
+        for (size_t i = 0; i < k; i++) pDistances[i] = sqrtf(pDistances[i]);
+    }
+    free(pQueries);
+}
+
+FeatureMatrix feature_matrix_create(WynnItemStatTable* pTable, size_t k, WorkerPool* pPool)
+{
+    FeatureMatrix matrix = {0};
+    ERR_RET(k == 0 || k > UINT32_MAX, ERR_INVALID_ARGS, matrix);
+    matrix.count = (uint32_t)pTable->count;
+    matrix.k = (uint32_t)(k < pTable->count ? k : pTable->count);
+    matrix.fingerprint = wynnitem_feature_fingerprint(pTable);
+    // An empty table has no rows to look up
+    if (matrix.count == 0) return matrix;
+
+    matrix.pRows = malloc((size_t)matrix.count * matrix.k * sizeof(uint32_t));
+    matrix.pDistances = malloc((size_t)matrix.count * matrix.k * sizeof(float));
+    if (matrix.pRows == NULL || matrix.pDistances == NULL)
+    {
+        feature_matrix_destroy(&matrix);
+        ERR_RET(true, ERR_FAILURE, matrix);
+    }
+
+    struct feature_matrix_build build = {&matrix, pTable, feature_scan_kernel(), false};
+    size_t taskCount = (matrix.count + FEATURE_MATRIX_QUERY_BLOCK - 1) / FEATURE_MATRIX_QUERY_BLOCK;
+    if (pPool != NULL)
+        worker_pool_run(pPool, feature_matrix_block_task, &build, taskCount);
+    else
+    {
+        for (size_t task = 0; task < taskCount; task++) feature_matrix_block_task(&build, task);
+    }
+
+    if (build.isFailed)
+    {
+        feature_matrix_destroy(&matrix);
+        ERR_RET(true, ERR_FAILURE, matrix);
+    }
+    return matrix;
+}
+
+void feature_matrix_destroy(FeatureMatrix* pMatrix)
+{
+    free(pMatrix->pRows);
+    free(pMatrix->pDistances);
+    *pMatrix = (FeatureMatrix){0};
+}
+
+size_t feature_matrix_size(FeatureMatrix* pMatrix)
+{
+    return sizeof(struct feature_matrix_header) + (size_t)pMatrix->count * pMatrix->k * (sizeof(uint32_t) + sizeof(float));
+}
+
+void feature_matrix_serialize(FeatureMatrix* pMatrix, uint8_t* pOut)
+{
+    struct feature_matrix_header header = {pMatrix->fingerprint, pMatrix->count, pMatrix->k};
+    size_t entryCount = (size_t)pMatrix->count * pMatrix->k;
+    memcpy(pOut, &header, sizeof(header));
+    if (entryCount == 0) return;
+
+    pOut += sizeof(header);
+    memcpy(pOut, pMatrix->pRows, entryCount * sizeof(uint32_t));
+    pOut += entryCount * sizeof(uint32_t);
+    memcpy(pOut, pMatrix->pDistances, entryCount * sizeof(float));
+}
+
+size_t feature_matrix_load(const uint8_t* pData, size_t size, WynnItemStatTable* pTable, size_t k, FeatureMatrix* pMatrixOut)
+{
+    *pMatrixOut = (FeatureMatrix){0};
+    struct feature_matrix_header header;
+    ERR_RET(pData == NULL || size < sizeof(header), ERR_PARSING, 0);
+    memcpy(&header, pData, sizeof(header));
+    ERR_RET(header.k > header.count, ERR_PARSING, 0);
+
+    size_t entryCount = (size_t)header.count * header.k;
+    size_t matrixSize = sizeof(header) + entryCount * (sizeof(uint32_t) + sizeof(float));
+    ERR_RET(matrixSize > size, ERR_PARSING, 0);
+
+    // A matrix of other items is skipped, the caller computes a new one
+    size_t tableK = k < pTable->count ? k : pTable->count;
+    if (header.count != pTable->count || header.k != tableK || header.fingerprint != wynnitem_feature_fingerprint(pTable))
+        return matrixSize;
+
+    FeatureMatrix matrix = {.count = header.count, .k = header.k, .fingerprint = header.fingerprint};
+    if (matrix.count == 0)
+    {
+        *pMatrixOut = matrix;
+        return matrixSize;
+    }
+
+    matrix.pRows = malloc(entryCount * sizeof(uint32_t));
+    matrix.pDistances = malloc(entryCount * sizeof(float));
+    if (matrix.pRows == NULL || matrix.pDistances == NULL)
+    {
+        feature_matrix_destroy(&matrix);
+        ERR_RET(true, ERR_FAILURE, 0);
+    }
+    memcpy(matrix.pRows, pData + sizeof(header), entryCount * sizeof(uint32_t));
+    memcpy(matrix.pDistances, pData + sizeof(header) + entryCount * sizeof(uint32_t), entryCount * sizeof(float));
+
+    // Lookups index the stat table with these
+    for (size_t i = 0; i < entryCount; i++)
+    {
+        if (matrix.pRows[i] < matrix.count) continue;
+        feature_matrix_destroy(&matrix);
+        ERR_RET(true, ERR_PARSING, 0);
+    }
+
+    *pMatrixOut = matrix;
+    return matrixSize;
+}
@@ -0,0 +1,61 @@
+#ifndef FEATUREMATRIX_H
+#define FEATUREMATRIX_H
+
+#include "wynnitems.h"
+#include "workerpool.h"
+
+// Neighbours kept per row
+#ifndef FEATURE_MATRIX_K
+#define FEATURE_MATRIX_K 32
+#endif
+// Rows scored against one block of the table while it is in cache, a block is one task
+#define FEATURE_MATRIX_QUERY_BLOCK 64
+// Table rows per block, the query columns of a block fit in L1 for most items
+#define FEATURE_MATRIX_ROW_BLOCK 512
+
+// The k closest rows of every row of one stat table, the sorted rows of the all pairs distance
+// matrix cut to k. Computed block by block as |a|^2 + |b|^2 - 2 a.b like a matrix product, each
+// block of table columns is loaded once and scored against a whole block of query rows.
+typedef struct
+{
+    uint32_t count;
+    uint32_t k;                 // Neighbours per row, fewer than asked if the table is smaller
+    uint64_t fingerprint;       // wynnitem_feature_fingerprint of the table
+    uint32_t* pRows;            // k per row, closest first, row r at r * k
+    float* pDistances;          // Feature distance of every neighbour
+} FeatureMatrix;
+
+/// @brief Scores every row of a table against every other one and keeps the k closest
+/// @param[in] pTable Table with features
+/// @param k Neighbours per row
+/// @param[in] pPool Workers to score query blocks on, NULL scores on the calling thread
+/// @return Matrix, destroy with feature_matrix_destroy
+FeatureMatrix feature_matrix_create(WynnItemStatTable* pTable, size_t k, WorkerPool* pPool);
+void feature_matrix_destroy(FeatureMatrix* pMatrix);
+
+/// @brief The neighbours of a row, O(k)
+/// @param[in] pMatrix Matrix
+/// @param row Stat table row
+/// @param[out] ppDistancesOut Distance of every neighbour, may be NULL
+/// @return k rows closest first, valid until the matrix is destroyed
+static inline const uint32_t* feature_matrix_row(FeatureMatrix* pMatrix, size_t row, const float** ppDistancesOut)
+{
+    if (ppDistancesOut != NULL) *ppDistancesOut = pMatrix->pDistances + row * pMatrix->k;
+    return pMatrix->pRows + row * pMatrix->k;
+}
+
+/// @brief Bytes feature_matrix_serialize writes
+size_t feature_matrix_size(FeatureMatrix* pMatrix);
+void feature_matrix_serialize(FeatureMatrix* pMatrix, uint8_t* pOut);
+
+/// @brief Loads a serialized matrix for a table
+/// @param[in] pData Serialized matrix
+/// @param size Bytes of pData, may run past the matrix
+/// @param[in] pTable Table the matrix has to belong to
+/// @param k Neighbours the matrix has to keep per row
+/// @param[out] pMatrixOut Matrix
+/// @return Bytes read, 0 if pData isn't a matrix. If it is one but for another table or k
+//  pMatrixOut is left empty
+size_t feature_matrix_load(const uint8_t* pData, size_t size, WynnItemStatTable* pTable, size_t k, FeatureMatrix* pMatrixOut);
+
+#endif // FEATUREMATRIX_H
@@ -0,0 +1,338 @@
+#include "featurescan.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <LTK/error_handling.h>
+#include <LTK/ansi_codes.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FEATURE_SCAN_X86
+#include <immintrin.h>
+#endif
+
+// Rows are done a register at a time with every column summed into it, so each distance is
+// written once however many columns the query has. Columns are visited in the same order by
+// every kernel, only FMA rounding differs from the scalar one.
+static void scan_scalar(
+    const float* const* ppColumns,
+    const float* pWeights,
+    size_t columnCount,
+    const float* pNorms,
+    float featureNorm,
+    size_t count,
+    float* pDistancesOut)
+{
+    for (size_t row = 0; row < count; row++)
+    {
+        float distance = featureNorm + pNorms[row];
+        for (size_t c = 0; c < columnCount; c++)
+        {
+            distance += pWeights[c] * ppColumns[c][row];
+        }
+        // Rounding can take an exact match a hair under 0
+        pDistancesOut[row] = distance > 0.f ? distance : 0.f;
+    }
+}
+
+#ifdef FEATURE_SCAN_X86
+__attribute__((target("sse4.2")))
+static void scan_sse42(
+    const float* const* ppColumns,
+    const float* pWeights,
+    size_t columnCount,
+    const float* pNorms,
+    float featureNorm,
+    size_t count,
+    float* pDistancesOut)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 norm = _mm_set1_ps(featureNorm);
+
+    size_t row = 0;
+    for (; row + 4 <= count; row += 4)
+    {
+        __m128 distance = _mm_add_ps(norm, _mm_loadu_ps(pNorms + row));
+        for (size_t c = 0; c < columnCount; c++)
+        {
+            __m128 product = _mm_mul_ps(_mm_set1_ps(pWeights[c]), _mm_loadu_ps(ppColumns[c] + row));
+            distance = _mm_add_ps(distance, product);
+        }
+        _mm_storeu_ps(pDistancesOut + row, _mm_max_ps(distance, zero));
+    }
+
+    const float* columns[columnCount + 1];
+    for (size_t c = 0; c < columnCount; c++) columns[c] = ppColumns[c] + row;
+    scan_scalar(columns, pWeights, columnCount, pNorms + row, featureNorm, count - row, pDistancesOut + row);
+}
+
+__attribute__((target("avx2,fma")))
+static void scan_avx2(
+    const float* const* ppColumns,
+    const float* pWeights,
+    size_t columnCount,
+    const float* pNorms,
+    float featureNorm,
+    size_t count,
+    float* pDistancesOut)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 norm = _mm256_set1_ps(featureNorm);
+
+    // Two registers per step hide the FMA latency
+    size_t row = 0;
+    for (; row + 16 <= count; row += 16)
+    {
+        __m256 distanceA = _mm256_add_ps(norm, _mm256_loadu_ps(pNorms + row));
+        __m256 distanceB = _mm256_add_ps(norm, _mm256_loadu_ps(pNorms + row + 8));
+        for (size_t c = 0; c < columnCount; c++)
+        {
+            __m256 weight = _mm256_set1_ps(pWeights[c]);
+            distanceA = _mm256_fmadd_ps(weight, _mm256_loadu_ps(ppColumns[c] + row), distanceA);
+            distanceB = _mm256_fmadd_ps(weight, _mm256_loadu_ps(ppColumns[c] + row + 8), distanceB);
+        }
+        _mm256_storeu_ps(pDistancesOut + row, _mm256_max_ps(distanceA, zero));
+        _mm256_storeu_ps(pDistancesOut + row + 8, _mm256_max_ps(distanceB, zero));
+    }
+    for (; row + 8 <= count; row += 8)
+    {
+        __m256 distance = _mm256_add_ps(norm, _mm256_loadu_ps(pNorms + row));
+        for (size_t c = 0; c < columnCount; c++)
+        {
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(pWeights[c]), _mm256_loadu_ps(ppColumns[c] + row), distance);
+        }
+        _mm256_storeu_ps(pDistancesOut + row, _mm256_max_ps(distance, zero));
+    }
+
+    const float* columns[columnCount + 1];
+    for (size_t c = 0; c < columnCount; c++) columns[c] = ppColumns[c] + row;
+    scan_scalar(columns, pWeights, columnCount, pNorms + row, featureNorm, count - row, pDistancesOut + row);
+}
+
+// Like AVX2 but the tail is masked instead of falling back to scalar
+__attribute__((target("avx512f")))
+static void scan_avx512(
+    const float* const* ppColumns,
+    const float* pWeights,
+    size_t columnCount,
+    const float* pNorms,
+    float featureNorm,
+    size_t count,
+    float* pDistancesOut)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 norm = _mm512_set1_ps(featureNorm);
+
+    size_t row = 0;
+    for (; row + 32 <= count; row += 32)
+    {
+        __m512 distanceA = _mm512_add_ps(norm, _mm512_loadu_ps(pNorms + row));
+        __m512 distanceB = _mm512_add_ps(norm, _mm512_loadu_ps(pNorms + row + 16));
+        for (size_t c = 0; c < columnCount; c++)
+        {
+            __m512 weight = _mm512_set1_ps(pWeights[c]);
+            distanceA = _mm512_fmadd_ps(weight, _mm512_loadu_ps(ppColumns[c] + row), distanceA);
+            distanceB = _mm512_fmadd_ps(weight, _mm512_loadu_ps(ppColumns[c] + row + 16), distanceB);
+        }
+        _mm512_storeu_ps(pDistancesOut + row, _mm512_max_ps(distanceA, zero));
+        _mm512_storeu_ps(pDistancesOut + row + 16, _mm512_max_ps(distanceB, zero));
+    }
+    for (; row < count; row += 16)
+    {
+        __mmask16 mask = count - row >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (count - row)) - 1);
+        __m512 distance = _mm512_add_ps(norm, _mm512_maskz_loadu_ps(mask, pNorms + row));
+        for (size_t c = 0; c < columnCount; c++)
+        {
+            __m512 column = _mm512_maskz_loadu_ps(mask, ppColumns[c] + row);
+            distance = _mm512_fmadd_ps(_mm512_set1_ps(pWeights[c]), column, distance);
+        }
+        _mm512_mask_storeu_ps(pDistancesOut + row, mask, _mm512_max_ps(distance, zero));
+    }
+}
+#endif
+
+static const char* gKernelName = NULL;
+
+FeatureScanKernel feature_scan_kernel()
+{
+    static FeatureScanKernel kernel = NULL;
+    if (kernel != NULL) return kernel;
+
+    FeatureScanKernel kernels[FEATURE_SCAN_MAX_KERNELS];
+    const char* names[FEATURE_SCAN_MAX_KERNELS];
+    size_t kernelCount = feature_scan_kernels(kernels, names);
+
+    gKernelName = names[kernelCount - 1];
+    kernel = kernels[kernelCount - 1];
+    return kernel;
+}
+
+const char* feature_scan_kernel_name()
+{
+    feature_scan_kernel();
+    return gKernelName;
+}
+
+size_t feature_scan_kernels(FeatureScanKernel* pKernelsOut, const char** pNamesOut)
+{
+    size_t kernelCount = 0;
+    pKernelsOut[kernelCount] = scan_scalar;
+    pNamesOut[kernelCount++] = "scalar";
+
+#ifdef FEATURE_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        pKernelsOut[kernelCount] = scan_sse42;
+        pNamesOut[kernelCount++] = "sse4.2";
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        pKernelsOut[kernelCount] = scan_avx2;
+        pNamesOut[kernelCount++] = "avx2";
+    }
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        pKernelsOut[kernelCount] = scan_avx512;
+        pNamesOut[kernelCount++] = "avx512";
+    }
+#endif
+
+    return kernelCount;
+}
+
+// ################################################################################
+// Kernel equivalence test
+//
+//
+// ################################################################################
+
+#define FEATURE_SCAN_TEST_COLUMNS 12
+#define FEATURE_SCAN_TEST_ROWS 1031
+// Rows past the count a kernel must not write
+#define FEATURE_SCAN_TEST_GUARD 32
+// Largest difference from the scalar kernel, relative to |q|^2 + |a|^2 + 1 like WYNNITEM_FEATURE_EPSILON
+#define FEATURE_SCAN_TEST_EPSILON 1e-5f
+
+static inline float test_random(uint32_t* pState)
+{
+    *pState ^= *pState << 13;
+    *pState ^= *pState >> 17;
+    *pState ^= *pState << 5;
+    return (float)(*pState >> 8) / (float)(1u << 23) - 1.f;
+}
+
+static bool feature_scan_test_case(
+    FeatureScanKernel kernel,
+    const float* pColumns,
+    const float* pNorms,
+    const float* pQuery,
+    size_t columnCount,
+    size_t count,
+    float* pReference,
+    float* pDistances)
+{
+    // Counts end where the buffers end so a read past them shows up under a sanitizer
+    size_t first = FEATURE_SCAN_TEST_ROWS - count;
+    const float* columns[FEATURE_SCAN_TEST_COLUMNS];
+    float weights[FEATURE_SCAN_TEST_COLUMNS];
+    float featureNorm = 0.f;
+    for (size_t c = 0; c < columnCount; c++)
+    {
+        columns[c] = pColumns + c * FEATURE_SCAN_TEST_ROWS + first;
+        weights[c] = -2.f * pQuery[c];
+        featureNorm += pQuery[c] * pQuery[c];
+    }
+
+    for (size_t row = 0; row < count + FEATURE_SCAN_TEST_GUARD; row++) pDistances[row] = -1.f;
+    scan_scalar(columns, weights, columnCount, pNorms + first, featureNorm, count, pReference);
+    kernel(columns, weights, columnCount, pNorms + first, featureNorm, count, pDistances);
+
+    for (size_t row = 0; row < count; row++)
+    {
+        float tolerance = FEATURE_SCAN_TEST_EPSILON * (1.f + featureNorm + pNorms[first + row]);
+        float difference = pDistances[row] - pReference[row];
+        if (pDistances[row] < 0.f || difference > tolerance || difference < -tolerance) return false;
+    }
+    for (size_t row = count; row < count + FEATURE_SCAN_TEST_GUARD; row++)
+    {
+        if (pDistances[row] != -1.f) return false;
+    }
+    return true;
+}
+
+bool feature_scan_test()
+{
+    FeatureScanKernel kernels[FEATURE_SCAN_MAX_KERNELS];
+    const char* kernelNames[FEATURE_SCAN_MAX_KERNELS];
+    size_t kernelCount = feature_scan_kernels(kernels, kernelNames);
+
+    // Every block width and tail of the kernels, and the whole buffer
+    static const size_t counts[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 100, FEATURE_SCAN_TEST_ROWS};
+    static const size_t columnCounts[] = {0, 1, 2, 5, FEATURE_SCAN_TEST_COLUMNS};
+
+    float* pColumns = malloc(FEATURE_SCAN_TEST_COLUMNS * FEATURE_SCAN_TEST_ROWS * sizeof(float));
+    float* pNorms = malloc(FEATURE_SCAN_TEST_ROWS * sizeof(float));
+    float* pReference = malloc(FEATURE_SCAN_TEST_ROWS * sizeof(float));
+    float* pDistances = malloc((FEATURE_SCAN_TEST_ROWS + FEATURE_SCAN_TEST_GUARD) * sizeof(float));
+    if (pColumns == NULL || pNorms == NULL || pReference == NULL || pDistances == NULL)
+    {
+        free(pDistances);
+        free(pReference);
+        free(pNorms);
+        free(pColumns);
+        ERR_RET(true, ERR_FAILURE, false);
+    }
+
+    // Fixed seed, the rows are the same on every run
+    uint32_t state = 0x9E3779B9u;
+    for (size_t i = 0; i < FEATURE_SCAN_TEST_COLUMNS * FEATURE_SCAN_TEST_ROWS; i++) pColumns[i] = test_random(&state);
+    for (size_t row = 0; row < FEATURE_SCAN_TEST_ROWS; row++)
+    {
+        pNorms[row] = 0.f;
+        for (size_t c = 0; c < FEATURE_SCAN_TEST_COLUMNS; c++)
+        {
+            float feature = pColumns[c * FEATURE_SCAN_TEST_ROWS + row];
+            pNorms[row] += feature * feature;
+        }
+    }
+
+    // A random query and one equal to the last row, whose distance rounds around 0 and gets clamped
+    float queries[2][FEATURE_SCAN_TEST_COLUMNS];
+    for (size_t c = 0; c < FEATURE_SCAN_TEST_COLUMNS; c++)
+    {
+        queries[0][c] = test_random(&state);
+        queries[1][c] = pColumns[c * FEATURE_SCAN_TEST_ROWS + FEATURE_SCAN_TEST_ROWS - 1];
+    }
+
+    bool isMatching = true;
+    for (size_t k = 1; k < kernelCount; k++)
+    {
+        printf(YELLOW"Testing %s feature scan against scalar...", kernelNames[k]);
+        bool isEqual = true;
+        for (size_t q = 0; q < 2 && isEqual; q++)
+        {
+            for (size_t i = 0; i < sizeof(columnCounts) / sizeof(columnCounts[0]) && isEqual; i++)
+            {
+                for (size_t j = 0; j < sizeof(counts) / sizeof(counts[0]) && isEqual; j++)
+                {
+                    isEqual = feature_scan_test_case(
+                        kernels[k], pColumns, pNorms, queries[q], columnCounts[i], counts[j], pReference, pDistances
+                    );
+                    if (!isEqual)
+                        printf(RED"Differs from scalar (%zu columns, %zu rows)\n"RESET, columnCounts[i], counts[j]);
+                }
+            }
+        }
+        isMatching &= isEqual;
+
+        if (isEqual)
+            printf(GREEN"Completed\n"RESET);
+    }
+
+    free(pDistances);
+    free(pReference);
+    free(pNorms);
+    free(pColumns);
+    return isMatching;
+}
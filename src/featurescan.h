@@ -0,0 +1,37 @@
+#ifndef FEATURESCAN_H
+#define FEATURESCAN_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Kernels use unaligned loads, on the 64 byte aligned stat table columns they never split a line
+#define FEATURE_SCAN_MAX_KERNELS 4
+
+// pDistancesOut[row] = max(0, featureNorm + pNorms[row] + sum over c of pWeights[c] * ppColumns[c][row])
+typedef void (*FeatureScanKernel)(
+    const float* const* ppColumns,
+    const float* pWeights,
+    size_t columnCount,
+    const float* pNorms,
+    float featureNorm,
+    size_t count,
+    float* pDistancesOut);
+
+/// @brief Widest kernel this cpu runs (AVX-512, AVX2 + FMA, SSE4.2 or scalar), picked on the first call
+FeatureScanKernel feature_scan_kernel();
+
+/// @brief Name of the kernel feature_scan_kernel picked
+const char* feature_scan_kernel_name();
+
+/// @brief Every kernel this cpu runs, scalar first, for benchmarks and equivalence checks
+/// @param[out] pKernelsOut FEATURE_SCAN_MAX_KERNELS kernels
+/// @param[out] pNamesOut FEATURE_SCAN_MAX_KERNELS names
+/// @return Number of kernels
+size_t feature_scan_kernels(FeatureScanKernel* pKernelsOut, const char** pNamesOut);
+
+/// @brief Checks every kernel this cpu runs against the scalar one on fixed generated rows, for row
+//  counts ending in each kernel tail and for results clamped at 0. Needs no item database.
+/// @return TRUE if every kernel is within rounding of the scalar one and writes only its rows
+bool feature_scan_test();
+
+#endif // FEATURESCAN_H
@@ -0,0 +1,247 @@
+#include "featuretree.h"
+#include "featurescan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <LTK/error_handling.h>
+
+struct feature_neighbour
+{
+    float distance;
+    uint32_t row;
+};
+
+struct feature_tree_range
+{
+    uint32_t begin;
+    uint32_t end;
+    float bound;        // Lower bound on the distance from the query to the range
+};
+
+// Only used to build the tree, queries score rows like the feature scan
+static inline float feature_distance(const float* pA, const float* pB)
+{
+    return sqrtf(wynnitem_point_distance_sqrd(pA, pB));
+}
+
+static inline void feature_neighbour_swap(struct feature_neighbour* pA, struct feature_neighbour* pB)
+{
+    struct feature_neighbour tmp = *pA;
+    *pA = *pB;
+    *pB = tmp;
+}
+
+// Moves the nth closest into place with closer ones before it and further ones after it.
+// Three way partitions so items with the same stats don't go quadratic.
+static void feature_neighbour_select(struct feature_neighbour* pEntries, size_t begin, size_t end, size_t nth)
+{
+    while (end - begin > 1)
+    {
+        float pivot = pEntries[begin + (end - begin) / 2].distance;
+        size_t less = begin, i = begin, greater = end;
+        while (i < greater)
+        {
+            if (pEntries[i].distance < pivot) feature_neighbour_swap(&pEntries[less++], &pEntries[i++]);
+            else if (pEntries[i].distance > pivot) feature_neighbour_swap(&pEntries[i], &pEntries[--greater]);
+            else i++;
+        }
+
+        if (nth < less) end = less;
+        else if (nth >= greater) begin = greater;
+        else return;
+    }
+}
+
+FeatureTree feature_tree_create(WynnItemStatTable* pTable)
+{
+    FeatureTree tree = {0};
+    tree.count = (uint32_t)pTable->count;
+    tree.stride = pTable->stride;
+    // Searches of an empty tree find nothing without touching its arrays
+    if (tree.count == 0) return tree;
+
+    size_t columnsSize = tree.stride * WYNNITEM_ID_ARRAY_SIZE * sizeof(float);
+    size_t normsSize = tree.stride * sizeof(float);
+    size_t nodesSize = (size_t)tree.count * (2 * sizeof(uint32_t) + sizeof(float));
+    size_t pointsSize = (size_t)tree.count * WYNNITEM_FEATURE_POINT_SIZE * sizeof(float);
+    tree.pMemory = calloc(1, columnsSize + normsSize + nodesSize + WYNNITEM_STAT_TABLE_ALIGNMENT);
+    float* pPoints = calloc(1, pointsSize);
+    struct feature_neighbour* pEntries = malloc(tree.count * sizeof(struct feature_neighbour));
+    struct feature_tree_range* pStack = malloc(tree.count * sizeof(struct feature_tree_range));
+    if (tree.pMemory == NULL || pPoints == NULL || pEntries == NULL || pStack == NULL)
+    {
+        free(pPoints);
+        free(pEntries);
+        free(pStack);
+        feature_tree_destroy(&tree);
+        ERR_RET(true, ERR_FAILURE, (FeatureTree){0});
+    }
+    uintptr_t aligned = ((uintptr_t)tree.pMemory + WYNNITEM_STAT_TABLE_ALIGNMENT - 1) &
+        ~(uintptr_t)(WYNNITEM_STAT_TABLE_ALIGNMENT - 1);
+    tree.pFeatures = (float*)aligned;
+    tree.pNorms = (float*)(aligned + columnsSize);
+    tree.pRows = (uint32_t*)(aligned + columnsSize + normsSize);
+    tree.pSplits = tree.pRows + tree.count;
+    tree.pRadii = (float*)(tree.pSplits + tree.count);
+
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        float* pColumn = wynnitem_feature_column(pTable, i);
+        for (uint32_t row = 0; row < tree.count; row++) pPoints[(size_t)row * WYNNITEM_FEATURE_POINT_SIZE + i] = pColumn[row];
+    }
+    for (uint32_t row = 0; row < tree.count; row++) pEntries[row] = (struct feature_neighbour){0.f, row};
+
+    // Every inner subtree is split at the median distance to a vantage point picked at random from
+    // it, the inside half directly follows the vantage point and the outside half follows that
+    uint32_t seed = 0x9E3779B9u;
+    size_t stackSize = 0;
+    pStack[stackSize++] = (struct feature_tree_range){0, tree.count, 0.f};
+    while (stackSize > 0)
+    {
+        struct feature_tree_range range = pStack[--stackSize];
+        if (range.end - range.begin <= FEATURE_TREE_LEAF_SIZE) continue;
+
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        feature_neighbour_swap(&pEntries[range.begin], &pEntries[range.begin + seed % (range.end - range.begin)]);
+
+        // The row furthest from a random one sits on the edge of the subtree, spheres around it
+        // cut the rest cleaner than ones around a row in the middle
+        const float* pVantage = pPoints + (size_t)pEntries[range.begin].row * WYNNITEM_FEATURE_POINT_SIZE;
+        uint32_t furthest = range.begin;
+        float furthestDistance = 0.f;
+        for (uint32_t i = range.begin + 1; i < range.end; i++)
+        {
+            float distance = feature_distance(pVantage, pPoints + (size_t)pEntries[i].row * WYNNITEM_FEATURE_POINT_SIZE);
+            if (distance > furthestDistance)
+            {
+                furthest = i;
+                furthestDistance = distance;
+            }
+        }
+        feature_neighbour_swap(&pEntries[range.begin], &pEntries[furthest]);
+
+        pVantage = pPoints + (size_t)pEntries[range.begin].row * WYNNITEM_FEATURE_POINT_SIZE;
+        for (uint32_t i = range.begin + 1; i < range.end; i++)
+        {
+            pEntries[i].distance = feature_distance(pVantage, pPoints + (size_t)pEntries[i].row * WYNNITEM_FEATURE_POINT_SIZE);
+        }
+
+        uint32_t split = range.begin + 1 + (range.end - range.begin - 1) / 2;
+        feature_neighbour_select(pEntries, range.begin + 1, range.end, split);
+        tree.pSplits[range.begin] = split;
+        tree.pRadii[range.begin] = pEntries[split].distance;
+        pStack[stackSize++] = (struct feature_tree_range){range.begin + 1, split, 0.f};
+        pStack[stackSize++] = (struct feature_tree_range){split, range.end, 0.f};
+    }
+
+    for (uint32_t node = 0; node < tree.count; node++)
+    {
+        uint32_t row = pEntries[node].row;
+        tree.pRows[node] = row;
+        tree.pNorms[node] = pTable->pFeatureNorms[row];
+        tree.maxNorm = tree.pNorms[node] > tree.maxNorm ? tree.pNorms[node] : tree.maxNorm;
+    }
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        float* pColumn = wynnitem_feature_column(pTable, i);
+        float* pTreeColumn = tree.pFeatures + i * tree.stride;
+        for (uint32_t node = 0; node < tree.count; node++) pTreeColumn[node] = pColumn[tree.pRows[node]];
+    }
+
+    free(pPoints);
+    free(pEntries);
+    free(pStack);
+    return tree;
+}
+
+void feature_tree_destroy(FeatureTree* pTree)
+{
+    free(pTree->pMemory);
+    *pTree = (FeatureTree){0};
+}
+
+// Inserts a row into the best ones found so far, sorted closest first
+static void feature_neighbour_keep(uint32_t* pRows, float* pDistances, size_t* pCount, size_t k, uint32_t row, float distance)
+{
+    size_t i = *pCount < k ? (*pCount)++ : k - 1;
+    for (; i > 0 && pDistances[i - 1] > distance; i--)
+    {
+        pRows[i] = pRows[i - 1];
+        pDistances[i] = pDistances[i - 1];
+    }
+    pRows[i] = row;
+    pDistances[i] = distance;
+}
+
+size_t feature_tree_knn(FeatureTree* pTree, const float* pFeatures, size_t k, uint32_t* pRowsOut, float* pDistancesOut)
+{
+    if (pTree->count == 0 || k == 0) return 0;
+
+    // Only the non zero query stats are scanned, like wynnitem_feature_scan
+    const float* columns[WYNNITEM_ID_ARRAY_SIZE];
+    const float* nodeColumns[WYNNITEM_ID_ARRAY_SIZE];
+    float weights[WYNNITEM_ID_ARRAY_SIZE];
+    size_t columnCount = 0;
+    float featureNorm = 0.f;
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        featureNorm += pFeatures[i] * pFeatures[i];
+        if (pFeatures[i] == 0.f) continue;
+
+        columns[columnCount] = pTree->pFeatures + i * pTree->stride;
+        weights[columnCount++] = -2.f * pFeatures[i];
+    }
+    FeatureScanKernel kernel = feature_scan_kernel();
+
+    // Scanned distances are off by up to the square root of the scan rounding error, so the
+    // triangle inequality only holds to within a few of those
+    float slack = 3.f * sqrtf(WYNNITEM_FEATURE_EPSILON * (1.f + featureNorm + pTree->maxNorm));
+
+    // Ranges on the stack never overlap, so there are at most count of them
+    struct feature_tree_range* pStack = malloc(pTree->count * sizeof(struct feature_tree_range));
+    ERR_RET(pStack == NULL, ERR_FAILURE, 0);
+    size_t stackSize = 0;
+    pStack[stackSize++] = (struct feature_tree_range){0, pTree->count, 0.f};
+
+    size_t foundCount = 0;
+    float radius = INFINITY;    // k-th best distance once k rows are found
+    float distances[FEATURE_TREE_LEAF_SIZE];
+    while (stackSize > 0)
+    {
+        // The radius may have shrunk since this range was pushed
+        struct feature_tree_range range = pStack[--stackSize];
+        if (range.bound >= radius + slack) continue;
+
+        // A leaf is scanned whole, an inner node only scans its vantage point
+        uint32_t node = range.begin;
+        bool isLeaf = range.end - range.begin <= FEATURE_TREE_LEAF_SIZE;
+        size_t scanCount = isLeaf ? range.end - range.begin : 1;
+        for (size_t c = 0; c < columnCount; c++) nodeColumns[c] = columns[c] + node;
+        kernel(nodeColumns, weights, columnCount, pTree->pNorms + node, featureNorm, scanCount, distances);
+        for (size_t i = 0; i < scanCount; i++) distances[i] = sqrtf(distances[i]);
+        for (size_t i = 0; i < scanCount; i++)
+        {
+            if (distances[i] >= radius) continue;
+            feature_neighbour_keep(pRowsOut, pDistancesOut, &foundCount, k, pTree->pRows[node + i], distances[i]);
+            if (foundCount == k) radius = pDistancesOut[k - 1];
+        }
+        if (isLeaf) continue;
+
+        // The side the query is on is pushed last so it is searched first and shrinks the radius
+        float distance = distances[0];
+        uint32_t split = pTree->pSplits[node];
+        float nodeRadius = pTree->pRadii[node];
+        struct feature_tree_range inside = {node + 1, split, distance > nodeRadius ? distance - nodeRadius : 0.f};
+        struct feature_tree_range outside = {split, range.end, nodeRadius > distance ? nodeRadius - distance : 0.f};
+        struct feature_tree_range first = distance < nodeRadius ? inside : outside;
+        struct feature_tree_range second = distance < nodeRadius ? outside : inside;
+        if (second.bound < radius + slack) pStack[stackSize++] = second;
+        if (first.bound < radius + slack) pStack[stackSize++] = first;
+    }
+
+    free(pStack);
+
+    return foundCount;
+}
@@ -0,0 +1,43 @@
+#ifndef FEATURETREE_H
+#define FEATURETREE_H
+
+#include "wynnitems.h"
+
+// Subtrees this small are leaves, scanned whole with the feature scan kernel
+#define FEATURE_TREE_LEAF_SIZE 64
+
+// Vantage point tree over the feature rows of one stat table, laid out in one array. The first
+// node of an inner subtree is its vantage point, the nodes up to pSplits of it are within pRadii
+// of it and the ones from pSplits to the end of the subtree are at least that far. By the triangle
+// inequality a query at distance d only has to enter a side d - radius or radius - d away if that
+// is under the k-th best distance found so far. Leaves are scanned like a stat table, with most
+// of the query stats 0 that is far cheaper per row than the inner nodes.
+typedef struct
+{
+    uint32_t count;
+    size_t stride;      // Column stride in floats
+    uint32_t* pRows;    // Node to stat table row
+    uint32_t* pSplits;  // First node outside the radius, inner nodes only
+    float* pRadii;
+    float* pFeatures;   // Stat table features in node order, same column layout
+    float* pNorms;      // Squared feature norm of every node
+    float maxNorm;
+    void* pMemory;
+} FeatureTree;
+
+/// @brief Builds a tree over the current features of a stat table, rebuild it whenever they change
+/// @param[in] pTable Table with features
+/// @return Tree, destroy with feature_tree_destroy
+FeatureTree feature_tree_create(WynnItemStatTable* pTable);
+void feature_tree_destroy(FeatureTree* pTree);
+
+/// @brief The k rows closest to a query, the same as sorting a full feature scan (up to ties)
+/// @param[in] pTree Tree
+/// @param[in] pFeatures Query from wynnitem_features
+/// @param k Rows wanted
+/// @param[out] pRowsOut Up to k stat table rows, closest first
+/// @param[out] pDistancesOut Feature distance of every row
+/// @return Rows found, fewer than k if the table is smaller
+size_t feature_tree_knn(FeatureTree* pTree, const float* pFeatures, size_t k, uint32_t* pRowsOut, float* pDistancesOut);
+
+#endif // FEATURETREE_H
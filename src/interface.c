@@ -3,6 +3,10 @@
 #include <raygui/raygui.h>
 #include <raygui/style_cyber.h>
 #include "wynnitems.h"
+#include "itemsearch.h"
+#include "nametrie.h"
+
+#define SEARCH_SUGGESTIONS 8
 
 static void draw_slider(float x, float y, size_t id, const char* name)
 {
@@ -16,9 +20,10 @@ static void draw_slider(float x, float y, size_t id, const char* name)
         // SUPER TEMP
         WynnBuild bestBuild = wynnitems_calculate_build(10000);
 
-        for (size_t i = 0; i < 9; ++i)
+        // Empty if a slot has no items
+        for (size_t i = 0; i < 9 && bestBuild.pItems[i] != NULL; ++i)
         {
-            printf("%s\n", bestBuild.pItems[i]->pName->str);
+            printf("%s\n", wynnitem_name(bestBuild.pItems[i])->str);
         }
         printf("\n");
     }
@@ -26,8 +31,42 @@ static void draw_slider(float x, float y, size_t id, const char* name)
         GuiDrawText(name, bounds, 0, WHITE);
 }
 
+static void draw_search(NameTrieSession* pSession, char* searchText, bool* pIsEditing, WynnItemList* pItemList)
+{
+    Rectangle bounds = {455, 1, 124, 12};
+    if (GuiTextBox(bounds, searchText, sizeof(WynnItemName), *pIsEditing))
+        *pIsEditing = !*pIsEditing;
+
+    // Only the characters typed or deleted since the last frame are redone
+    name_trie_session_set(pSession, searchText);
+    if (searchText[0] == '\0') return;
+
+    struct levenshtein_item suggestions[SEARCH_SUGGESTIONS];
+    size_t suggestionCount = name_trie_session_suggest(pSession, suggestions, SEARCH_SUGGESTIONS);
+    for (size_t i = 0; i < suggestionCount; i++)
+    {
+        Rectangle itemBounds = {bounds.x, bounds.y + bounds.height + 1 + 9 * i, bounds.width, 8};
+        if (GuiLabelButton(itemBounds, wynnitem_name(suggestions[i].pItem)->str))
+        {
+            printf("Selected: '%s'\n", wynnitem_name(suggestions[i].pItem)->str);
+            scored_items_print(suggestions[i].pItem, pItemList);
+        }
+    }
+}
+
 int iteminterface_run(void* pArgs)
 {
+    WynnItemList* pItemList = pArgs;
+    NameTrie nameTrie = {0};
+    NameTrieSession nameSession = {0};
+    char searchText[sizeof(WynnItemName)] = {0};
+    bool isSearchEditing = false;
+    if (pItemList != NULL)
+    {
+        nameTrie = name_trie_create(pItemList);
+        nameSession = name_trie_session_create(&nameTrie, NAME_TRIE_SEARCH_MAX_DIST);
+    }
+
     SetTraceLogLevel(LOG_ERROR);
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     SetTargetFPS(120);
@@ -61,11 +100,17 @@ int iteminterface_run(void* pArgs)
             draw_slider((float)right, (float)down, id, wynnItemIdNames[i]);
             id++;
         }
+
+        if (pItemList != NULL)
+            draw_search(&nameSession, searchText, &isSearchEditing, pItemList);
         
         EndMode2D();
         EndDrawing();
     }
     CloseWindow();
 
+    name_trie_session_destroy(&nameSession);
+    name_trie_destroy(&nameTrie);
+
     return 0;
 }
\ No newline at end of file
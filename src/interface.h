@@ -1,6 +1,9 @@
 #ifndef ITEMINTERFACE_H
 #define ITEMINTERFACE_H
 
+/// @brief Opens the item window and runs it until it is closed
+/// @param[in] pArgs Loaded WynnItemList for the name search box, NULL leaves the search out
+/// @return 0
 int iteminterface_run(void* pArgs);
 
 #endif // ITEMINTERFACE_H
\ No newline at end of file
@@ -1,61 +1,173 @@
 #include "itemloader.h"
 #include <LTK/dataio.h>
 #include <LTK/jsonparser.h>
+#include "jsonstream.h"
+#include "wynnkeyhash.h"
+#include "nameindex.h"
+#include "nametokens.h"
+#include "timing.h"
+#include "binfile.h"
 #include <LTK/error_handling.h>
 #include <LTK/ansi_codes.h>
+#include <LTK/threading.h>
 #include <stdio.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
 
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#elif defined(PLATFORM_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+typedef struct
+{
+    uint8_t* pData;
+    size_t size;
+#ifdef PLATFORM_WINDOWS
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} WynnItemMapping;
+
+typedef enum
+{
+    WYNNITEM_BIN_ENCODING_RAW = 0,      // Fixed size records, usable in place
+    WYNNITEM_BIN_ENCODING_PACKED = 1,   // Varint records and a packed name heap, decoded on load
+} WynnItemBinEncoding;
+
+// Json items are extracted on up to this many threads, each into its own pools
+#ifndef WYNNITEM_LOAD_MAX_THREADS
+#define WYNNITEM_LOAD_MAX_THREADS 32
+#endif
+// Smallest json slice worth a thread
+#ifndef WYNNITEM_LOAD_THREAD_BYTES
+#define WYNNITEM_LOAD_THREAD_BYTES (256 * 1024)
+#endif
+
+typedef struct
+{
+    WynnItemPool itemPool;
+    WynnItemNamePool namePool;
+} WynnItemShard;
+
 static WynnItemPool gItemPool = {0};
 static WynnItemNamePool gNamePool = {0};
 static WynnItemList gItemList = {0};
+static WynnItemMapping gMapping = {0};
+static WynnItemShard gShards[WYNNITEM_LOAD_MAX_THREADS] = {0};
+static size_t gShardCount = 0;
+static WynnItem** gShardItems = NULL;  // Items held by gShards sorted by address, they can't go back to gItemPool
+static size_t gShardItemCount = 0;
+static WynnItemLoadMode gLoadMode = WYNNITEM_LOAD_COPY;
+static WynnItemNameHash gNameHash = {0};
+static WynnItemNameTable gNameTable = {0};
+static WynnItemTokenIndex gTokenIndex = {0};
+static bool isNameIndexInit = false;
 static bool isInit = false;
 
 static WynnItemList wynnitems_load_json(
-    JsonValue* pRoot, 
-    WynnItemPool* pItemPool, 
-    WynnItemNamePool* pNamePool);
+    const char* jsonString,
+    size_t length,
+    WynnItemShard* pShards, 
+    size_t* pShardCountOut);
+static void wynnitem_shards_destroy(WynnItemShard* pShards, size_t shardCount);
+static void wynnitem_shard_items_index(WynnItemList* pItemList);
+static bool wynnitem_is_pooled(WynnItem* pItem);
 static WynnItemList wynnitem_load_bin(
     uint8_t* pData,
+    size_t size,
     WynnItemPool* pItemPool, 
     WynnItemNamePool* pNamePool);
-static uint8_t* wynnitem_dump_bin(WynnItemList* pItemList, size_t* pSizeOut);
-
-static inline uint64_t get_timing()
-{
-    struct timespec spec;
-    timespec_get(&spec, TIME_UTC);
-
-    return spec.tv_nsec + spec.tv_sec * 1000000000ULL;
-}
+static WynnItemList wynnitem_map_bin(uint8_t* pData);
+static const char* wynnitem_bin_check(uint8_t* pData, size_t size, bool checkPayload);
+static uint8_t* wynnitem_dump_bin(
+    WynnItemList* pItemList, 
+    WynnItemBinEncoding encoding, 
+    size_t* pSizeOut);
+static WynnItemBinEncoding wynnitem_bin_encoding(uint8_t* pData);
+static bool wynnitem_mapping_open(WynnItemMapping* pMapping, const char* path);
+static void wynnitem_mapping_close(WynnItemMapping* pMapping);
+static void wynnitem_name_indexes_destroy();
 
-static inline double timing_to_float(uint64_t start, uint64_t end)
-{
-    return ((double)(end - start)) / 1000000000.0;    
-}
-
-WynnItemList* wynnitems_load(char* dbBinPath, char* dbUrl)
+WynnItemList* wynnitems_load(char* dbBinPath, char* dbUrl, WynnItemLoadMode loadMode)
 {
     ERR_RET(isInit, ERR_FAILURE, NULL);
 
     gItemPool = wynnitem_pool_create();
     gNamePool = wynnitem_name_pool_create();
+    gLoadMode = loadMode;
 
     uint64_t timeStart, timeEnd;
-    if (dataio_isfile(dbBinPath))
+    const char* staleReason = NULL;
+    bool isLoaded = false;
+    bool isMapped = false;
+    if (dataio_isfile(dbBinPath) && loadMode == WYNNITEM_LOAD_MAPPED)
+    {
+        // A cache that can't be mapped is still read like a copy load
+        isMapped = wynnitem_mapping_open(&gMapping, dbBinPath);
+        if (!isMapped)
+            printf(RED"Could not map (%s), reading it instead\n"RESET, dbBinPath);
+    }
+
+    if (isMapped)
+    {
+        printf(YELLOW"Mapping item database from (%s)...", dbBinPath);
+        timeStart = get_timing();
+        // Section payloads are not checksummed here, that would fault in every page
+        staleReason = wynnitem_bin_check(gMapping.pData, gMapping.size, false);
+        if (staleReason == NULL && wynnitem_bin_encoding(gMapping.pData) == WYNNITEM_BIN_ENCODING_RAW)
+        {
+            gItemList = wynnitem_map_bin(gMapping.pData);
+            if (wynnitem_list_is_init(&gItemList))
+                isLoaded = true;
+            else
+            {
+                staleReason = "name offset mismatch";
+                wynnitem_mapping_close(&gMapping);
+            }
+        }
+        else
+        {
+            // Packed caches can't be used in place, they are checked and decoded like a read cache
+            if (staleReason == NULL)
+                staleReason = wynnitem_bin_check(gMapping.pData, gMapping.size, true);
+            if (staleReason == NULL)
+            {
+                gItemList = wynnitem_load_bin(gMapping.pData, gMapping.size, &gItemPool, &gNamePool);
+                isLoaded = true;
+            }
+            wynnitem_mapping_close(&gMapping);
+        }
+        timeEnd = get_timing();
+    }
+    else if (dataio_isfile(dbBinPath))
     {
         printf(YELLOW"Reading item database from (%s)...", dbBinPath);
         timeStart = get_timing();
-        uint8_t* pData = dataio_read(dbBinPath, NULL);
-        gItemList = wynnitem_load_bin(pData, &gItemPool, &gNamePool);
+        size_t size = 0;
+        uint8_t* pData = dataio_read(dbBinPath, &size);
+        staleReason = wynnitem_bin_check(pData, size, true);
+        if (staleReason == NULL)
+        {
+            gItemList = wynnitem_load_bin(pData, size, &gItemPool, &gNamePool);
+            isLoaded = true;
+        }
         free(pData);
         timeEnd = get_timing();
-        printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
     }
-    else
+
+    if (isLoaded)
+        printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
+    else if (staleReason != NULL)
+        printf(RED"Cache is stale (%s), rebuilding\n"RESET, staleReason);
+
+    if (!isLoaded)
     {
         printf(YELLOW"Downloading item database from (%s)...", dbUrl);
         timeStart = get_timing();
@@ -64,43 +176,396 @@ WynnItemList* wynnitems_load(char* dbBinPath, char* dbUrl)
         timeEnd = get_timing();
         printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
 
-        printf(YELLOW"Parsing json...");
+        printf(YELLOW"Streaming items from json...");
         timeStart = get_timing();
-        JsonPool jsonPool = json_pool_create();
-        JsonValue* pRoot = json_parse(&jsonPool, jsonString);
+        gItemList = wynnitems_load_json(jsonString, size, gShards, &gShardCount);
         free(jsonString);
+        wynnitem_shard_items_index(&gItemList);
         timeEnd = get_timing();
         printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
+    }
 
-        printf(YELLOW"Loading items from json value tree...");
-        timeStart = get_timing();
-        gItemList = wynnitems_load_json(pRoot, &gItemPool, &gNamePool);
-        json_pool_destroy(&jsonPool);
-        timeEnd = get_timing();
-        printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
+    isInit = true;
+    if (!isLoaded)
+        wynnitems_save(dbBinPath);
 
-        printf(YELLOW"Writing item database to (%s)...", dbBinPath);
-        timeStart = get_timing();
-        size_t writeSize = 0;
-        uint8_t* pWriteData = wynnitem_dump_bin(&gItemList, &writeSize);
-        dataio_write(dbBinPath, pWriteData, writeSize);
-        free(pWriteData);
-        timeEnd = get_timing();
-        printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
+    return &gItemList;
+}
+
+static bool wynnitem_equals(WynnItem* pItemA, WynnItem* pItemB)
+{
+    return pItemA->type == pItemB->type && pItemA->tier == pItemB->tier &&
+        pItemA->class == pItemB->class && pItemA->powderSlots == pItemB->powderSlots &&
+        pItemA->attackSpeed == pItemB->attackSpeed &&
+        !memcmp(pItemA->idArray, pItemB->idArray, sizeof(pItemA->idArray)) &&
+        !strcmp(wynnitem_name(pItemA)->str, wynnitem_name(pItemB)->str);
+}
+
+static int wynnitem_name_cmp(const void* pA, const void* pB)
+{
+    return strcmp(wynnitem_name(*(WynnItem**)pA)->str, wynnitem_name(*(WynnItem**)pB)->str);
+}
+
+WynnItemList* wynnitems_refresh(char* dbBinPath, char* dbUrl, WynnItemDiff* pDiffOut)
+{
+    ERR_RET(!isInit, ERR_FAILURE, NULL);
+    ERR_RET(pDiffOut == NULL, ERR_INVALID_ARGS, NULL);
+
+#ifdef PLATFORM_WINDOWS
+    // Windows can't replace a file with a view open, the refreshed items could never be saved and
+    // the next load would map the old ones again
+    if (gMapping.pData != NULL)
+    {
+        printf(RED"Can't refresh a mapped cache on Windows, load it with WYNNITEM_LOAD_COPY to refresh\n"RESET);
+        ERR_RET(true, ERR_FAILURE, NULL);
     }
+#endif
 
-    isInit = true;
+    printf(YELLOW"Downloading item database from (%s)...", dbUrl);
+    uint64_t timeStart = get_timing();
+    size_t size = 0;
+    char* jsonString = (char*)dataio_get(dbUrl, &size);
+    uint64_t timeEnd = get_timing();
+    ERR_RET(jsonString == NULL, ERR_IO_FAILED, NULL);
+    printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
+
+    printf(YELLOW"Streaming items from json...");
+    timeStart = get_timing();
+    WynnItemShard newShards[WYNNITEM_LOAD_MAX_THREADS];
+    size_t newShardCount = 0;
+    WynnItemList newList = wynnitems_load_json(jsonString, size, newShards, &newShardCount);
+    free(jsonString);
+    timeEnd = get_timing();
+    if (!wynnitem_list_is_init(&newList))
+    {
+        wynnitem_shards_destroy(newShards, newShardCount);
+        ERR_RET(true, ERR_PARSING, NULL);
+    }
+    printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
+
+    printf(YELLOW"Diffing against the loaded items...");
+    timeStart = get_timing();
+
+    // Old items sorted by name so every new item is a binary search
+    size_t oldCount = wynnitem_list_size(&gItemList);
+    size_t newCount = wynnitem_list_size(&newList);
+    WynnItem** ppOldItems = NULL;
+    bool* pMatched = NULL;
+    if (oldCount > 0)
+    {
+        ppOldItems = malloc(oldCount * sizeof(WynnItem*));
+        pMatched = calloc(oldCount, sizeof(bool));
+        if (ppOldItems == NULL || pMatched == NULL)
+        {
+            free(ppOldItems);
+            free(pMatched);
+            wynnitem_list_destroy(&newList);
+            wynnitem_shards_destroy(newShards, newShardCount);
+            ERR_RET(true, ERR_FAILURE, NULL);
+        }
+        wynnitem_list_to_array(&gItemList, ppOldItems);
+        qsort(ppOldItems, oldCount, sizeof(WynnItem*), wynnitem_name_cmp);
+    }
+
+    *pDiffOut = (WynnItemDiff){wynnitem_list_create(), wynnitem_list_create()};
+    WynnItemList itemList = wynnitem_list_create();
+    wynnitem_list_reserve(&itemList, newCount);
+
+    for (size_t i = 0; i < newCount; i++)
+    {
+        WynnItem* pNewItem = wynnitem_list_get(&newList, i);
+        WynnItem** ppFound = oldCount > 0 ? 
+            bsearch(&pNewItem, ppOldItems, oldCount, sizeof(WynnItem*), wynnitem_name_cmp) : NULL;
+        bool isOld = ppFound != NULL && !pMatched[ppFound - ppOldItems];
+        if (isOld)
+            pMatched[ppFound - ppOldItems] = true;
+
+        if (isOld && wynnitem_equals(*ppFound, pNewItem))
+        {
+            wynnitem_list_append(&itemList, *ppFound);
+            continue;
+        }
+        if (isOld)
+            wynnitem_list_append(&pDiffOut->removed, *ppFound);
+
+        // Changed items are replaced, mapped items are read only and other code may hold the old pointer
+        WynnItem* pItem = wynnitem_pool_alloc(&gItemPool);
+        *pItem = *pNewItem;
+        WynnItemName* pName = wynnitem_name_pool_alloc(&gNamePool);
+        *pName = *wynnitem_name(pNewItem);
+        wynnitem_name_set(pItem, pName);
+
+        wynnitem_list_append(&itemList, pItem);
+        wynnitem_list_append(&pDiffOut->added, pItem);
+    }
 
+    for (size_t i = 0; i < oldCount; i++)
+    {
+        if (!pMatched[i])
+            wynnitem_list_append(&pDiffOut->removed, ppOldItems[i]);
+    }
+
+    // gItemList itself stays at the same address for anyone holding it
+    wynnitem_list_destroy(&gItemList);
+    gItemList = itemList;
+
+    // Rows are list positions, every added or removed item shifts them
+    wynnitem_name_indexes_destroy();
+
+    free(pMatched);
+    free(ppOldItems);
+    wynnitem_list_destroy(&newList);
+    wynnitem_shards_destroy(newShards, newShardCount);
+    timeEnd = get_timing();
+    printf(GREEN"Completed: %.3lfs (%zu added, %zu removed)\n"RESET, timing_to_float(timeStart, timeEnd),
+        wynnitem_list_size(&pDiffOut->added), wynnitem_list_size(&pDiffOut->removed));
+
+    if (wynnitem_list_size(&pDiffOut->added) == 0 && wynnitem_list_size(&pDiffOut->removed) == 0)
+        return &gItemList;
+
+    // The old cache is still valid and would load the old items without a word
+    if (!wynnitems_save(dbBinPath))
+    {
+        if (remove(dbBinPath) == 0)
+            printf(RED"Removed the cache, the next load downloads the items again\n"RESET);
+        else
+            printf(RED"Could not remove the cache either, the next load reads the old items from it\n"RESET);
+    }
     return &gItemList;
 }
 
+bool wynnitems_save(char* dbBinPath)
+{
+    ERR_RET(!isInit, ERR_FAILURE, false);
+
+    printf(YELLOW"Writing item database to (%s)...", dbBinPath);
+    uint64_t timeStart = get_timing();
+    size_t writeSize = 0;
+    WynnItemBinEncoding encoding = gLoadMode == WYNNITEM_LOAD_PACKED ? 
+        WYNNITEM_BIN_ENCODING_PACKED : WYNNITEM_BIN_ENCODING_RAW;
+    uint8_t* pWriteData = wynnitem_dump_bin(&gItemList, encoding, &writeSize);
+    ERR_RET(pWriteData == NULL, ERR_FAILURE, false);
+    bool isWritten = bin_file_replace(dbBinPath, pWriteData, writeSize);
+    free(pWriteData);
+    uint64_t timeEnd = get_timing();
+    if (isWritten)
+        printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, timeEnd));
+    else
+        printf(RED"Could not replace the cache\n"RESET);
+
+    return isWritten;
+}
+
+// Built on the first lookup, so a mapped load doesn't read every name at startup. They hold item
+// pointers, which differ every load, so they are never cached.
+static void wynnitem_name_indexes_create()
+{
+    if (isNameIndexInit) return;
+
+    gNameHash = wynnitem_name_hash_create(&gItemList);
+    gNameTable = wynnitem_name_table_create(&gItemList);
+    gTokenIndex = wynnitem_token_index_create(&gNameTable);
+    isNameIndexInit = true;
+}
+
+static void wynnitem_name_indexes_destroy()
+{
+    wynnitem_name_hash_destroy(&gNameHash);
+    wynnitem_name_table_destroy(&gNameTable);
+    wynnitem_token_index_destroy(&gTokenIndex);
+    isNameIndexInit = false;
+}
+
+WynnItemNameHash* wynnitems_name_hash()
+{
+    ERR_RET(!isInit, ERR_FAILURE, NULL);
+
+    wynnitem_name_indexes_create();
+    return &gNameHash;
+}
+
+WynnItemNameTable* wynnitems_name_table()
+{
+    ERR_RET(!isInit, ERR_FAILURE, NULL);
+
+    wynnitem_name_indexes_create();
+    return &gNameTable;
+}
+
+WynnItemTokenIndex* wynnitems_token_index()
+{
+    ERR_RET(!isInit, ERR_FAILURE, NULL);
+
+    wynnitem_name_indexes_create();
+    return &gTokenIndex;
+}
+
+void wynnitem_diff_destroy(WynnItemDiff* pDiff)
+{
+    ERR_RET(pDiff == NULL, ERR_INVALID_ARGS,);
+
+    // Shard and mapped items stay until wynnitems_unload, shards never allocate again so only
+    // gItemPool items can be reused by the next refresh
+    size_t removedCount = isInit ? wynnitem_list_size(&pDiff->removed) : 0;
+    for (size_t i = 0; i < removedCount; i++)
+    {
+        WynnItem* pItem = wynnitem_list_get(&pDiff->removed, i);
+        if (!wynnitem_is_pooled(pItem)) continue;
+        wynnitem_name_pool_return(&gNamePool, wynnitem_name(pItem));
+        wynnitem_pool_return(&gItemPool, pItem);
+    }
+
+    wynnitem_list_destroy(&pDiff->removed);
+    wynnitem_list_destroy(&pDiff->added);
+}
+
 void wynnitems_unload()
 {
     ERR_RET(!isInit, ERR_FAILURE,);
 
+    wynnitem_name_indexes_destroy();
     wynnitem_list_destroy(&gItemList);
     wynnitem_name_pool_destroy(&gNamePool);
     wynnitem_pool_destroy(&gItemPool);
+    wynnitem_shards_destroy(gShards, gShardCount);
+    gShardCount = 0;
+    free(gShardItems);
+    gShardItems = NULL;
+    gShardItemCount = 0;
+    wynnitem_mapping_close(&gMapping);
+    isInit = false;
+}
+
+
+// Loads a cache file the way wynnitems_load would, NULL pools map it in place instead
+static bool wynnitem_cache_benchmark_load(
+    const char* path, 
+    WynnItemPool* pItemPool, 
+    WynnItemNamePool* pNamePool, 
+    WynnItemList* pItemListOut)
+{
+    *pItemListOut = (WynnItemList){0};
+    if (pItemPool == NULL)
+    {
+        WynnItemMapping mapping = {0};
+        if (!wynnitem_mapping_open(&mapping, path)) return false;
+        bool isLoaded = wynnitem_bin_check(mapping.pData, mapping.size, false) == NULL;
+        if (isLoaded)
+        {
+            *pItemListOut = wynnitem_map_bin(mapping.pData);
+            isLoaded = wynnitem_list_is_init(pItemListOut);
+        }
+        // The list is only destroyed after this, its items are never read again
+        wynnitem_mapping_close(&mapping);
+        return isLoaded;
+    }
+
+    size_t size = 0;
+    uint8_t* pData = dataio_read(path, &size);
+    bool isLoaded = wynnitem_bin_check(pData, size, true) == NULL;
+    if (isLoaded)
+        *pItemListOut = wynnitem_load_bin(pData, size, pItemPool, pNamePool);
+    free(pData);
+    return isLoaded && wynnitem_list_is_init(pItemListOut);
+}
+
+bool wynnitems_cache_benchmark(WynnItemList* pItemList, char* scratchPath, size_t iterations)
+{
+    ERR_RET(pItemList == NULL || scratchPath == NULL || iterations == 0, ERR_INVALID_ARGS, false);
+
+    // Mapped is the raw cache used in place, it is only timed from the file
+    const char* encodingNames[] = {"raw", "packed", "mapped"};
+    WynnItemBinEncoding encodings[] = {WYNNITEM_BIN_ENCODING_RAW, WYNNITEM_BIN_ENCODING_PACKED, WYNNITEM_BIN_ENCODING_RAW};
+    size_t sizes[lengthof(encodings)] = {0};
+    double encodeTimes[lengthof(encodings)] = {0};
+    double decodeTimes[lengthof(encodings)] = {0};
+    double loadTimes[lengthof(encodings)] = {0};
+    bool isMatching = true;
+
+    for (size_t e = 0; e < lengthof(encodings); e++)
+    {
+        bool isMapped = e == 2;
+        printf(YELLOW"Benchmarking %s cache (%zu loads)...", encodingNames[e], iterations);
+
+        uint64_t timeStart = get_timing();
+        uint8_t* pData = wynnitem_dump_bin(pItemList, encodings[e], &sizes[e]);
+        encodeTimes[e] = timing_to_float(timeStart, get_timing());
+        ERR_RET(pData == NULL, ERR_FAILURE, false);
+        dataio_write(scratchPath, pData, sizes[e]);
+
+        bool isEqual = true;
+        for (size_t it = 0; it < iterations; it++)
+        {
+            WynnItemPool itemPool = wynnitem_pool_create();
+            WynnItemNamePool namePool = wynnitem_name_pool_create();
+            WynnItemList itemList = {0};
+
+            // Check and decode of a cache already in memory
+            if (!isMapped)
+            {
+                timeStart = get_timing();
+                bool isDecoded = wynnitem_bin_check(pData, sizes[e], true) == NULL;
+                if (isDecoded)
+                    itemList = wynnitem_load_bin(pData, sizes[e], &itemPool, &namePool);
+                decodeTimes[e] += timing_to_float(timeStart, get_timing());
+
+                isEqual &= isDecoded && wynnitem_list_is_init(&itemList);
+                if (it == 0 && isEqual)
+                {
+                    isEqual = wynnitem_list_size(&itemList) == wynnitem_list_size(pItemList);
+                    for (size_t i = 0; isEqual && i < wynnitem_list_size(pItemList); i++)
+                        isEqual = wynnitem_equals(wynnitem_list_get(&itemList, i), wynnitem_list_get(pItemList, i));
+                }
+                if (wynnitem_list_is_init(&itemList))
+                    wynnitem_list_destroy(&itemList);
+            }
+
+            // Same again from the file, timed from opening it like a start. Whether its pages
+            // come from the disk or the page cache is up to the OS.
+            timeStart = get_timing();
+            isEqual &= wynnitem_cache_benchmark_load(
+                scratchPath, isMapped ? NULL : &itemPool, isMapped ? NULL : &namePool, &itemList);
+            loadTimes[e] += timing_to_float(timeStart, get_timing());
+
+            if (wynnitem_list_is_init(&itemList))
+                wynnitem_list_destroy(&itemList);
+            wynnitem_name_pool_destroy(&namePool);
+            wynnitem_pool_destroy(&itemPool);
+        }
+        decodeTimes[e] /= (double)iterations;
+        loadTimes[e] /= (double)iterations;
+        free(pData);
+        isMatching &= isEqual;
+
+        if (isEqual)
+            printf(GREEN"Completed\n"RESET);
+        else
+            printf(RED"Round trip mismatch\n"RESET);
+    }
+    remove(scratchPath);
+
+    for (size_t e = 0; e < 2; e++)
+    {
+        printf(
+            "  %-7s %10zu bytes (%5.1lf%%)  encode %8.3lfms  decode %8.3lfms  load %8.3lfms (%.1lf MB/s)\n",
+            encodingNames[e], sizes[e], 100.0 * (double)sizes[e] / (double)sizes[0], 
+            encodeTimes[e] * 1000.0, decodeTimes[e] * 1000.0, loadTimes[e] * 1000.0,
+            (double)sizes[0] / loadTimes[e] / 1000000.0
+        );
+    }
+    printf("  %-7s %10zu bytes %58s %8.3lfms\n", encodingNames[2], sizes[2], "load", loadTimes[2] * 1000.0);
+
+    // Reading packed wins whenever the bytes it saves take longer to read than its extra decode time
+    double extraDecode = decodeTimes[1] - decodeTimes[0];
+    if (extraDecode <= 0.0)
+        printf("  Packed is faster at any read speed\n");
+    else
+        printf(
+            "  Packed is faster below %.1lf MB/s of read throughput\n", 
+            (double)(sizes[0] - sizes[1]) / extraDecode / 1000000.0
+        );
+
+    return isMatching;
 }
 
 // ##########################################################################################
@@ -111,321 +576,931 @@ void wynnitems_unload()
 //
 // ##########################################################################################
 
-inline static int32_t min_max_entry(JsonValue* pSection, const char* keyString)
+typedef enum
+{
+    WYNNITEM_SECTION_NONE,
+    WYNNITEM_SECTION_REQS,
+    WYNNITEM_SECTION_BASE,
+    WYNNITEM_SECTION_IDS,
+} WynnItemSection;
+
+// Must match keyhash in gen_keyhash.py
+static inline uint32_t wynnitem_keyhash(uint32_t seed, const char* key, size_t length)
 {
-    JsonKey key = {0};
-    strcpy_s(key.str, sizeof(key.str), keyString);
+    uint32_t hash = seed;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+/// Returns the idArray index of a section key or -1 if the key isn't tracked
+static int32_t wynnitem_key_index(WynnItemSection section, const JsonStreamValue* pKey)
+{
+    const struct wynnitem_keyhash_entry* pEntries = NULL;
+    const uint8_t* pSlots = NULL;
+    uint32_t seed = 0;
+    uint32_t mask = 0;
+    switch (section)
+    {
+        case WYNNITEM_SECTION_REQS:
+            pEntries = wynnItemReqsKeyEntries, pSlots = wynnItemReqsKeySlots;
+            seed = WYNNITEM_KEYHASH_REQS_SEED, mask = (1u << WYNNITEM_KEYHASH_REQS_BITS) - 1;
+            break;
+        case WYNNITEM_SECTION_BASE:
+            pEntries = wynnItemBaseKeyEntries, pSlots = wynnItemBaseKeySlots;
+            seed = WYNNITEM_KEYHASH_BASE_SEED, mask = (1u << WYNNITEM_KEYHASH_BASE_BITS) - 1;
+            break;
+        case WYNNITEM_SECTION_IDS:
+            pEntries = wynnItemIdsKeyEntries, pSlots = wynnItemIdsKeySlots;
+            seed = WYNNITEM_KEYHASH_IDS_SEED, mask = (1u << WYNNITEM_KEYHASH_IDS_BITS) - 1;
+            break;
+        default: return -1;
+    }
 
-    JsonValue* pHealth = json_object_get(pSection, key);
-    if (pHealth == NULL) return 0;
+    // Tracked keys never contain escapes
+    if (pKey->escaped) return -1;
 
-    if (json_is_type(pHealth, JSON_VALUE_TYPE_NUMBER))
-        return (int32_t)json_to_number(pHealth);
+    uint8_t slot = pSlots[wynnitem_keyhash(seed, pKey->str, pKey->length) & mask];
+    if (slot == 0) return -1;
 
-    return (int32_t)json_to_number(json_object_get(pHealth, (JsonKey){"max"}));
+    const struct wynnitem_keyhash_entry* pEntry = &pEntries[slot - 1];
+    if (pEntry->length != pKey->length || memcmp(pEntry->key, pKey->str, pKey->length)) return -1;
+    return pEntry->index;
 }
 
-static WynnItemList wynnitems_load_json(
-    JsonValue* pRoot, 
-    WynnItemPool* pItemPool, 
-    WynnItemNamePool* pNamePool)
-{   
-    WynnItemList itemList = wynnitem_list_create();
+#ifndef NDEBUG
+// Catches wynnkeyhash.h going stale after the name tables change
+static bool wynnitem_keyhash_verify()
+{
+    struct {WynnItemSection section; const char** names; size_t count; size_t offset;} sections[] = {
+        {WYNNITEM_SECTION_REQS, wynnItemReqsNames, lengthof(wynnItemReqsNames), WYNNITEM_REQ_LEVEL},
+        {WYNNITEM_SECTION_BASE, wynnItemBaseNames, lengthof(wynnItemBaseNames), WYNNITEM_BASE_AVERAGE_DPS},
+        {WYNNITEM_SECTION_IDS, wynnItemIdNames, lengthof(wynnItemIdNames), WYNNITEM_ID_RAW_ATTACK_SPEED},
+    };
 
-    JsonValue* pJsonItem = NULL;
-    JsonKey itemName = {0};
-    while ((pJsonItem = json_object_next(pRoot, &itemName)))
-    {   
-        WynnItem item = {0};
-        JsonValue* pTypeStr = json_object_get(pJsonItem, (JsonKey){"type"});
-        const char* type = json_to_string(pTypeStr);
-        if (!strcmp(type, "weapon"))
-        {
-            item.type = WYNNITEM_TYPE_WEAPON;
-        }
-        else if (!strcmp(type, "armour"))
-        {
-            JsonValue* pArmourTypeValue = json_object_get(pJsonItem, (JsonKey){"armourType"});
-            const char* armourType = json_to_string(pArmourTypeValue);
-            if (!strcmp(armourType, "helmet")) item.type = WYNNITEM_TYPE_HELMET;
-            else if (!strcmp(armourType, "chestplate")) item.type = WYNNITEM_TYPE_CHESTPLATE;
-            else if (!strcmp(armourType, "leggings")) item.type = WYNNITEM_TYPE_LEGGINGS;
-            else if (!strcmp(armourType, "boots")) item.type = WYNNITEM_TYPE_BOOTS;
-            else ERR_RET(true, ERR_FAILURE, (WynnItemList){0});
-        }
-        else continue;
-            // else if (!strcmp(type, "ring")) item.type = WYNNITEM_TYPE_RING;
-            // else if (!strcmp(type, "bracelet")) item.type = WYNNITEM_TYPE_BRACELET;
-            // else if (!strcmp(type, "necklace")) item.type = WYNNITEM_TYPE_NECKLACE;
-        
-
-        JsonValue* pRarityStr = json_object_get(pJsonItem, (JsonKey){"rarity"});
-        const char* rarity = json_to_string(pRarityStr);
-        if (!strcmp(rarity, "common")) item.tier = WYNNITEM_TIER_COMMON;
-        else if (!strcmp(rarity, "unique")) item.tier = WYNNITEM_TIER_UNIQUE;
-        else if (!strcmp(rarity, "rare")) item.tier = WYNNITEM_TIER_RARE;
-        else if (!strcmp(rarity, "legendary")) item.tier = WYNNITEM_TIER_LEGENDARY;
-        else if (!strcmp(rarity, "fabled")) item.tier = WYNNITEM_TIER_FABLED;
-        else if (!strcmp(rarity, "mythic")) item.tier = WYNNITEM_TIER_MYTHIC;
-        else if (!strcmp(rarity, "set")) item.tier = WYNNITEM_TIER_SET;
-        else ERR_RET(true, ERR_FAILURE, (WynnItemList){0});
-
-        JsonValue* pAttackSpeedStr = json_object_get(pJsonItem, (JsonKey){"attackSpeed"});
-        if (pAttackSpeedStr != NULL)
+    for (size_t i = 0; i < lengthof(sections); i++)
+    {
+        for (size_t j = 0; j < sections[i].count; j++)
         {
-            const char* speed = json_to_string(pAttackSpeedStr);
-            if (!strcmp(speed, "super_slow")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_SUPER_SLOW;
-            else if (!strcmp(speed, "very_slow")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_VERY_SLOW;
-            else if (!strcmp(speed, "slow")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_SLOW;
-            else if (!strcmp(speed, "normal")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_NORMAL;
-            else if (!strcmp(speed, "fast")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_FAST;
-            else if (!strcmp(speed, "very_fast")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_VERY_FAST;
-            else if (!strcmp(speed, "super_fast")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_SUPER_FAST;
-            else ERR_RET(true, ERR_FAILURE, (WynnItemList){0});
+            JsonStreamValue key = {
+                .valueType = JSON_VALUE_TYPE_STRING, 
+                .str = sections[i].names[j], 
+                .length = strlen(sections[i].names[j]),
+            };
+            ERR_RETM(
+                wynnitem_key_index(sections[i].section, &key) != (int32_t)(sections[i].offset + j), 
+                ERR_FAILURE, false, "wynnkeyhash.h is stale, run gen_keyhash.py");
         }
+    }
+    return true;
+}
+#endif
 
-        JsonValue* pReqsSection = json_object_get(pJsonItem, (JsonKey){"requirements"});
-        if (pReqsSection != NULL)
-        {
-            JsonValue* pClassReq = json_object_get(pJsonItem, (JsonKey){"classRequirement"});
-            if (pClassReq != NULL)
-            {
-                const char* class = json_to_string(pClassReq);
-                if (!strcmp(class, "mage")) item.class = WYNNITEM_CLASS_ARCHER;
-                else if (!strcmp(class, "warrior")) item.class = WYNNITEM_CLASS_WARRIOR;
-                else if (!strcmp(class, "archer")) item.class = WYNNITEM_CLASS_ARCHER;
-                else if (!strcmp(class, "assassin")) item.class = WYNNITEM_CLASS_ASSASSIN;
-                else if (!strcmp(class, "shaman")) item.class = WYNNITEM_CLASS_SHAMAN;
-                else ERR_RET(true, ERR_FAILURE, (WynnItemList){0});
-            }
+#define WYNNITEM_FIELD_SIZE 32
 
-            item.reqs.level = min_max_entry(pReqsSection, "level");
-            item.reqs.strength = min_max_entry(pReqsSection, "strength");
-            item.reqs.dexterity = min_max_entry(pReqsSection, "dexterity");
-            item.reqs.defence = min_max_entry(pReqsSection, "defence");
-            item.reqs.agility = min_max_entry(pReqsSection, "agility");
-            item.reqs.intelligence = min_max_entry(pReqsSection, "intelligence");
-        }
+// Builds items straight from json_parse_stream events
+// Depth 1 is the root object, 2 an item, 3 a section and 4 a {"min", "max"} pair.
+struct wynnitem_builder
+{
+    WynnItemPool* pItemPool;
+    WynnItemNamePool* pNamePool;
+    WynnItemList* pItemList;
+    size_t depth;
 
-        JsonValue* pBaseSection = json_object_get(pJsonItem, (JsonKey){"base"});
-        if (pBaseSection != NULL)
-        {
-            item.base.averageDPS = min_max_entry(pBaseSection, "averageDPS");
-            item.base.damage = min_max_entry(pBaseSection, "damage");
-            item.base.earthDamage = min_max_entry(pBaseSection, "earthDamage");
-            item.base.thunderDamage = min_max_entry(pBaseSection, "thunderDamage");
-            item.base.fireDamage = min_max_entry(pBaseSection, "fireDamage");
-            item.base.airDamage = min_max_entry(pBaseSection, "airDamage");
-            item.base.waterDamage = min_max_entry(pBaseSection, "waterDamage");
-
-            item.base.health = min_max_entry(pBaseSection, "health");
-            item.base.earthDefence = min_max_entry(pBaseSection, "earthDefence");
-            item.base.thunderDefence = min_max_entry(pBaseSection, "thunderDefence");
-            item.base.fireDefence = min_max_entry(pBaseSection, "fireDefence");
-            item.base.airDefence = min_max_entry(pBaseSection, "airDefence");
-            item.base.waterDefence = min_max_entry(pBaseSection, "waterDefence");
-        }
+    WynnItem item;
+    WynnItemName name;
+    // Item fields are kept as strings until the item closes since key order isn't fixed
+    char type[WYNNITEM_FIELD_SIZE];
+    char armourType[WYNNITEM_FIELD_SIZE];
+    char rarity[WYNNITEM_FIELD_SIZE];
+    char attackSpeed[WYNNITEM_FIELD_SIZE];
+    char classRequirement[WYNNITEM_FIELD_SIZE];
 
-        JsonValue* pIdsSection = json_object_get(pJsonItem, (JsonKey){"identifications"});
-        if (pIdsSection != NULL)
-        {
-            item.ids.rawAttackSpeed = min_max_entry(pIdsSection, "rawAttackSpeed");
-
-            item.ids.rawStrength = min_max_entry(pIdsSection, "rawStrength");
-            item.ids.rawDexterity = min_max_entry(pIdsSection, "rawDexterity");
-            item.ids.rawDefence = min_max_entry(pIdsSection, "rawDefence");
-            item.ids.rawAgility = min_max_entry(pIdsSection, "rawAgility");
-            item.ids.rawIntelligence = min_max_entry(pIdsSection, "rawIntelligence");
-
-            item.ids.elementalDamage = min_max_entry(pIdsSection, "elementalDamage");
-            item.ids.earthDamage = min_max_entry(pIdsSection, "earthDamage");
-            item.ids.thunderDamage = min_max_entry(pIdsSection, "thunderDamage");
-            item.ids.fireDamage = min_max_entry(pIdsSection, "fireDamage");
-            item.ids.airDamage = min_max_entry(pIdsSection, "airDamage");
-            item.ids.waterDamage = min_max_entry(pIdsSection, "waterDamage");
-
-            item.ids.elementalDefence = min_max_entry(pIdsSection, "elementalDefence");
-            item.ids.earthDefence = min_max_entry(pIdsSection, "earthDefence");
-            item.ids.airDefence = min_max_entry(pIdsSection, "airDefence");
-            item.ids.fireDefence = min_max_entry(pIdsSection, "fireDefence");
-            item.ids.thunderDefence = min_max_entry(pIdsSection, "thunderDefence");
-            item.ids.waterDefence = min_max_entry(pIdsSection, "waterDefence");
-
-            item.ids.rawElementalDamage = min_max_entry(pIdsSection, "rawElementalDamage");
-            item.ids.rawEarthDamage = min_max_entry(pIdsSection, "rawEarthDamage");
-            item.ids.rawThunderDamage = min_max_entry(pIdsSection, "rawThunderDamage");
-            item.ids.rawFireDamage = min_max_entry(pIdsSection, "rawFireDamage");
-            item.ids.rawAirDamage = min_max_entry(pIdsSection, "rawAirDamage");
-            item.ids.rawWaterDamage = min_max_entry(pIdsSection, "rawWaterDamage");
-
-            item.ids.mainAttackDamage = min_max_entry(pIdsSection, "mainAttackDamage");
-            item.ids.earthMainAttackDamage = min_max_entry(pIdsSection, "earthMainAttackDamage");
-            item.ids.thunderMainAttackDamage = min_max_entry(pIdsSection, "thunderMainAttackDamage");
-            item.ids.fireMainAttackDamage = min_max_entry(pIdsSection, "fireMainAttackDamage");
-            item.ids.airMainAttackDamage = min_max_entry(pIdsSection, "airMainAttackDamage");
-            item.ids.waterMainAttackDamage = min_max_entry(pIdsSection, "waterMainAttackDamage");
-
-            item.ids.rawMainAttackDamage = min_max_entry(pIdsSection, "rawMainAttackDamage");
-            item.ids.rawElementalMainAttackDamage = min_max_entry(pIdsSection, "rawElementalMainAttackDamage");
-            item.ids.rawEarthMainAttackDamage = min_max_entry(pIdsSection, "rawEarthMainAttackDamage");
-            item.ids.rawThunderMainAttackDamage = min_max_entry(pIdsSection, "rawThunderMainAttackDamage");
-            item.ids.rawFireMainAttackDamage = min_max_entry(pIdsSection, "rawFireMainAttackDamage");
-            item.ids.rawAirMainAttackDamage = min_max_entry(pIdsSection, "rawAirMainAttackDamage");
-            item.ids.rawWaterMainAttackDamage = min_max_entry(pIdsSection, "rawWaterMainAttackDamage");
-
-            item.ids.spellDamage = min_max_entry(pIdsSection, "spellDamage");
-            item.ids.elementalSpellDamage = min_max_entry(pIdsSection, "elementalSpellDamage");
-            item.ids.fireSpellDamage = min_max_entry(pIdsSection, "fireSpellDamage");
-            item.ids.waterSpellDamage = min_max_entry(pIdsSection, "waterSpellDamage");
-            item.ids.earthSpellDamage = min_max_entry(pIdsSection, "earthSpellDamage");
-            item.ids.thunderSpellDamage = min_max_entry(pIdsSection, "thunderSpellDamage");
-            item.ids.airSpellDamage = min_max_entry(pIdsSection, "airSpellDamage");
-
-            item.ids.rawSpellDamage = min_max_entry(pIdsSection, "rawSpellDamage");
-            item.ids.rawNeutralSpellDamage = min_max_entry(pIdsSection, "rawNeutralSpellDamage");
-            item.ids.rawElementalSpellDamage = min_max_entry(pIdsSection, "rawElementalSpellDamage");
-            item.ids.rawEarthSpellDamage = min_max_entry(pIdsSection, "rawEarthSpellDamage");
-            item.ids.rawThunderSpellDamage = min_max_entry(pIdsSection, "rawThunderSpellDamage");
-            item.ids.rawFireSpellDamage = min_max_entry(pIdsSection, "rawFireSpellDamage");
-            item.ids.rawAirSpellDamage = min_max_entry(pIdsSection, "rawAirSpellDamage");
-            item.ids.rawWaterSpellDamage = min_max_entry(pIdsSection, "rawWaterSpellDamage");
-
-            item.ids.healing = min_max_entry(pIdsSection, "healing");
-            item.ids.rawHealth = min_max_entry(pIdsSection, "rawHealth");
-            item.ids.healingEfficiency = min_max_entry(pIdsSection, "healingEfficiency");
-            item.ids.healthRegen = min_max_entry(pIdsSection, "healthRegen");
-            item.ids.healthRegenRaw = min_max_entry(pIdsSection, "healthRegenRaw");
-            item.ids.lifeSteal = min_max_entry(pIdsSection, "lifeSteal");
-
-            item.ids.manaRegen = min_max_entry(pIdsSection, "manaRegen");
-            item.ids.manaSteal = min_max_entry(pIdsSection, "manaSteal");
-
-            item.ids.sprint = min_max_entry(pIdsSection, "sprint");
-            item.ids.sprintRegen = min_max_entry(pIdsSection, "sprintRegen");
-            item.ids.walkSpeed = min_max_entry(pIdsSection, "walkSpeed");
-            item.ids.jumpHeight = min_max_entry(pIdsSection, "jumpHeight");
-
-            item.ids.thorns = min_max_entry(pIdsSection, "thorns");
-            item.ids.reflection = min_max_entry(pIdsSection, "reflection");
-            item.ids.knockback = min_max_entry(pIdsSection, "knockback");
-            item.ids.exploding = min_max_entry(pIdsSection, "exploding");
-            item.ids.poison = min_max_entry(pIdsSection, "poison");
-
-            item.ids.stealing = min_max_entry(pIdsSection, "stealing");
-            item.ids.xpBonus = min_max_entry(pIdsSection, "xpBonus");
-            item.ids.lootBonus = min_max_entry(pIdsSection, "lootBonus");
-            item.ids.soulPointRegen = min_max_entry(pIdsSection, "soulPointRegen");
-
-            item.ids.SpellCost1st = min_max_entry(pIdsSection, "1stSpellCost");
-            item.ids.SpellCost2nd = min_max_entry(pIdsSection, "2ndSpellCost");
-            item.ids.SpellCost3rd = min_max_entry(pIdsSection, "3rdSpellCost");
-            item.ids.SpellCost4th = min_max_entry(pIdsSection, "4thSpellCost");
-
-            item.ids.rawSpellCost1st = min_max_entry(pIdsSection, "raw1stSpellCost");
-            item.ids.rawSpellCost2nd = min_max_entry(pIdsSection, "raw2ndSpellCost");
-            item.ids.rawSpellCost3rd = min_max_entry(pIdsSection, "raw3rdSpellCost");
-            item.ids.rawSpellCost4th = min_max_entry(pIdsSection, "raw4thSpellCost");
-
-            item.ids.slowEnemy = min_max_entry(pIdsSection, "slowEnemy");
-            item.ids.weakenEnemy = min_max_entry(pIdsSection, "weakenEnemy");
-        }
+    char* pPendingField;
+    WynnItemSection pendingSection;
+    WynnItemSection section;
+    int32_t keyIndex;
+    int32_t maxIndex;
+};
 
-        item.pName = wynnitem_name_pool_alloc(pNamePool);
-        memset(item.pName->str, 0, sizeof(item.pName->str));
-        strncpy_s(item.pName->str, sizeof(item.pName->str), itemName.str, sizeof(itemName.str));
+static bool wynnitem_builder_finish(struct wynnitem_builder* pBuilder)
+{
+    WynnItem item = pBuilder->item;
 
-        WynnItem* pItem = wynnitem_pool_alloc(pItemPool);
-        *pItem = item;
+    if (!strcmp(pBuilder->type, "weapon"))
+    {
+        item.type = WYNNITEM_TYPE_WEAPON;
+    }
+    else if (!strcmp(pBuilder->type, "armour"))
+    {
+        const char* armourType = pBuilder->armourType;
+        if (!strcmp(armourType, "helmet")) item.type = WYNNITEM_TYPE_HELMET;
+        else if (!strcmp(armourType, "chestplate")) item.type = WYNNITEM_TYPE_CHESTPLATE;
+        else if (!strcmp(armourType, "leggings")) item.type = WYNNITEM_TYPE_LEGGINGS;
+        else if (!strcmp(armourType, "boots")) item.type = WYNNITEM_TYPE_BOOTS;
+        else ERR_RET(true, ERR_FAILURE, false);
+    }
+    else return true;
+        // else if (!strcmp(type, "ring")) item.type = WYNNITEM_TYPE_RING;
+        // else if (!strcmp(type, "bracelet")) item.type = WYNNITEM_TYPE_BRACELET;
+        // else if (!strcmp(type, "necklace")) item.type = WYNNITEM_TYPE_NECKLACE;
 
-        wynnitem_list_append(&itemList, pItem);
+    const char* rarity = pBuilder->rarity;
+    if (!strcmp(rarity, "common")) item.tier = WYNNITEM_TIER_COMMON;
+    else if (!strcmp(rarity, "unique")) item.tier = WYNNITEM_TIER_UNIQUE;
+    else if (!strcmp(rarity, "rare")) item.tier = WYNNITEM_TIER_RARE;
+    else if (!strcmp(rarity, "legendary")) item.tier = WYNNITEM_TIER_LEGENDARY;
+    else if (!strcmp(rarity, "fabled")) item.tier = WYNNITEM_TIER_FABLED;
+    else if (!strcmp(rarity, "mythic")) item.tier = WYNNITEM_TIER_MYTHIC;
+    else if (!strcmp(rarity, "set")) item.tier = WYNNITEM_TIER_SET;
+    else ERR_RET(true, ERR_FAILURE, false);
+
+    const char* speed = pBuilder->attackSpeed;
+    if (speed[0] != '\0')
+    {
+        if (!strcmp(speed, "super_slow")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_SUPER_SLOW;
+        else if (!strcmp(speed, "very_slow")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_VERY_SLOW;
+        else if (!strcmp(speed, "slow")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_SLOW;
+        else if (!strcmp(speed, "normal")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_NORMAL;
+        else if (!strcmp(speed, "fast")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_FAST;
+        else if (!strcmp(speed, "very_fast")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_VERY_FAST;
+        else if (!strcmp(speed, "super_fast")) item.attackSpeed = WYNNITEM_ATTACK_SPEED_SUPER_FAST;
+        else ERR_RET(true, ERR_FAILURE, false);
     }
+
+    const char* class = pBuilder->classRequirement;
+    if (class[0] != '\0')
+    {
+        if (!strcmp(class, "mage")) item.class = WYNNITEM_CLASS_ARCHER;
+        else if (!strcmp(class, "warrior")) item.class = WYNNITEM_CLASS_WARRIOR;
+        else if (!strcmp(class, "archer")) item.class = WYNNITEM_CLASS_ARCHER;
+        else if (!strcmp(class, "assassin")) item.class = WYNNITEM_CLASS_ASSASSIN;
+        else if (!strcmp(class, "shaman")) item.class = WYNNITEM_CLASS_SHAMAN;
+        else ERR_RET(true, ERR_FAILURE, false);
+    }
+
+    WynnItemName* pName = wynnitem_name_pool_alloc(pBuilder->pNamePool);
+    *pName = pBuilder->name;
+
+    WynnItem* pItem = wynnitem_pool_alloc(pBuilder->pItemPool);
+    *pItem = item;
+    wynnitem_name_set(pItem, pName);
+
+    wynnitem_list_append(pBuilder->pItemList, pItem);
+    return true;
+}
+
+static bool wynnitem_builder_on_key(void* pUser, const JsonStreamValue* pKey)
+{
+    struct wynnitem_builder* pBuilder = pUser;
+    switch (pBuilder->depth)
+    {
+        case 1:
+            json_stream_unescape(pKey, pBuilder->name.str, sizeof(pBuilder->name.str));
+            break;
+        case 2:
+            pBuilder->pPendingField = NULL;
+            pBuilder->pendingSection = WYNNITEM_SECTION_NONE;
+            if (json_stream_equals(pKey, "type")) pBuilder->pPendingField = pBuilder->type;
+            else if (json_stream_equals(pKey, "armourType")) pBuilder->pPendingField = pBuilder->armourType;
+            else if (json_stream_equals(pKey, "rarity")) pBuilder->pPendingField = pBuilder->rarity;
+            else if (json_stream_equals(pKey, "attackSpeed")) pBuilder->pPendingField = pBuilder->attackSpeed;
+            else if (json_stream_equals(pKey, "classRequirement")) pBuilder->pPendingField = pBuilder->classRequirement;
+            else if (json_stream_equals(pKey, "requirements")) pBuilder->pendingSection = WYNNITEM_SECTION_REQS;
+            else if (json_stream_equals(pKey, "base")) pBuilder->pendingSection = WYNNITEM_SECTION_BASE;
+            else if (json_stream_equals(pKey, "identifications")) pBuilder->pendingSection = WYNNITEM_SECTION_IDS;
+            break;
+        case 3:
+            pBuilder->keyIndex = wynnitem_key_index(pBuilder->section, pKey);
+            break;
+        case 4:
+            pBuilder->maxIndex = json_stream_equals(pKey, "max") ? pBuilder->keyIndex : -1;
+            break;
+    }
+    return true;
+}
+
+static bool wynnitem_builder_on_value(void* pUser, const JsonStreamValue* pValue)
+{
+    struct wynnitem_builder* pBuilder = pUser;
+    bool isNumber = pValue->valueType == JSON_VALUE_TYPE_NUMBER;
+    switch (pBuilder->depth)
+    {
+        case 2:
+            if (pBuilder->pPendingField != NULL && pValue->valueType == JSON_VALUE_TYPE_STRING)
+                json_stream_unescape(pValue, pBuilder->pPendingField, WYNNITEM_FIELD_SIZE);
+            pBuilder->pPendingField = NULL;
+            break;
+        case 3:
+            if (isNumber && pBuilder->keyIndex >= 0)
+                pBuilder->item.idArray[pBuilder->keyIndex] = (int32_t)pValue->number;
+            break;
+        case 4:
+            if (isNumber && pBuilder->maxIndex >= 0)
+                pBuilder->item.idArray[pBuilder->maxIndex] = (int32_t)pValue->number;
+            break;
+    }
+    return true;
+}
+
+static bool wynnitem_builder_on_enter(void* pUser, JsonValueType valueType)
+{
+    struct wynnitem_builder* pBuilder = pUser;
+    pBuilder->depth++;
+
+    if (pBuilder->depth == 2)
+    {
+        WynnItemName name = pBuilder->name;
+        *pBuilder = (struct wynnitem_builder){
+            .pItemPool = pBuilder->pItemPool,
+            .pNamePool = pBuilder->pNamePool,
+            .pItemList = pBuilder->pItemList,
+            .depth = pBuilder->depth,
+            .name = name,
+        };
+    }
+    else if (pBuilder->depth == 3)
+    {
+        pBuilder->section = valueType == JSON_VALUE_TYPE_OBJECT ? pBuilder->pendingSection : WYNNITEM_SECTION_NONE;
+        pBuilder->keyIndex = -1;
+    }
+    else if (pBuilder->depth == 4)
+    {
+        pBuilder->maxIndex = -1;
+    }
+    return true;
+}
+
+static bool wynnitem_builder_on_leave(void* pUser, JsonValueType valueType)
+{
+    struct wynnitem_builder* pBuilder = pUser;
+
+    if (pBuilder->depth == 2 && valueType == JSON_VALUE_TYPE_OBJECT && !wynnitem_builder_finish(pBuilder))
+        return false;
+    if (pBuilder->depth == 3) pBuilder->section = WYNNITEM_SECTION_NONE;
+    if (pBuilder->depth == 4) pBuilder->keyIndex = -1;
+
+    pBuilder->depth--;
+    return true;
+}
+
+struct wynnitem_load_task
+{
+    const char* jsonString;     // Root members slice
+    size_t length;
+    WynnItemShard* pShard;
+    WynnItemList itemList;
+    bool isParsed;
+};
+
+static int wynnitem_load_task_run(void* pArgs)
+{
+    struct wynnitem_load_task* pTask = pArgs;
+
+    // Root object is already entered, the slice starts at an item name
+    struct wynnitem_builder builder = {
+        .pItemPool = &pTask->pShard->itemPool,
+        .pNamePool = &pTask->pShard->namePool,
+        .pItemList = &pTask->itemList,
+        .depth = 1,
+    };
+    JsonStreamCallbacks callbacks = {
+        .onKey = wynnitem_builder_on_key,
+        .onValue = wynnitem_builder_on_value,
+        .onEnter = wynnitem_builder_on_enter,
+        .onLeave = wynnitem_builder_on_leave,
+    };
+
+    pTask->isParsed = json_parse_stream_members(pTask->jsonString, pTask->length, &callbacks, &builder);
+    return pTask->isParsed ? 0 : 1;
+}
+
+static size_t wynnitem_load_thread_count(size_t length)
+{
+#ifdef PLATFORM_WINDOWS
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    size_t cores = systemInfo.dwNumberOfProcessors;
+#elif defined(PLATFORM_UNIX)
+    long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t cores = onlineCores > 0 ? (size_t)onlineCores : 1;
+#endif
+
+    size_t threadCount = length / WYNNITEM_LOAD_THREAD_BYTES;
+    threadCount = threadCount < cores ? threadCount : cores;
+    threadCount = threadCount < WYNNITEM_LOAD_MAX_THREADS ? threadCount : WYNNITEM_LOAD_MAX_THREADS;
+    return threadCount > 0 ? threadCount : 1;
+}
+
+static int wynnitem_address_cmp(const void* pA, const void* pB)
+{
+    uintptr_t a = (uintptr_t)*(WynnItem**)pA;
+    uintptr_t b = (uintptr_t)*(WynnItem**)pB;
+    return (a > b) - (a < b);
+}
+
+// Every item of a json load is in a shard
+static void wynnitem_shard_items_index(WynnItemList* pItemList)
+{
+    size_t count = wynnitem_list_is_init(pItemList) ? wynnitem_list_size(pItemList) : 0;
+    if (count == 0) return;
+
+    gShardItems = malloc(count * sizeof(WynnItem*));
+    ERR_RET(gShardItems == NULL, ERR_FAILURE,);
+    wynnitem_list_to_array(pItemList, gShardItems);
+    qsort(gShardItems, count, sizeof(WynnItem*), wynnitem_address_cmp);
+    gShardItemCount = count;
+}
+
+// TRUE if an item was allocated from gItemPool
+static bool wynnitem_is_pooled(WynnItem* pItem)
+{
+    if (gMapping.pData != NULL && 
+        (uint8_t*)pItem >= gMapping.pData && (uint8_t*)pItem < gMapping.pData + gMapping.size)
+        return false;
+    if (gShardCount == 0) return true;
+    // Without the index any item may be a shard item, they are all left alone
+    if (gShardItems == NULL) return false;
+
+    return bsearch(&pItem, gShardItems, gShardItemCount, sizeof(WynnItem*), wynnitem_address_cmp) == NULL;
+}
+
+static void wynnitem_shards_destroy(WynnItemShard* pShards, size_t shardCount)
+{
+    for (size_t i = 0; i < shardCount; i++)
+    {
+        wynnitem_name_pool_destroy(&pShards[i].namePool);
+        wynnitem_pool_destroy(&pShards[i].itemPool);
+    }
+}
+
+// Creates the shards, every item is allocated from the shard of the thread that built it
+static WynnItemList wynnitems_load_json(
+    const char* jsonString,
+    size_t length,
+    WynnItemShard* pShards, 
+    size_t* pShardCountOut)
+{   
+    *pShardCountOut = 0;
+#ifndef NDEBUG
+    ERR_RET(!wynnitem_keyhash_verify(), ERR_FAILURE, (WynnItemList){0});
+#endif
+
+    JsonStreamRange ranges[WYNNITEM_LOAD_MAX_THREADS];
+    size_t taskCount = json_stream_split(jsonString, length, ranges, wynnitem_load_thread_count(length));
+    ERR_RET(taskCount == 0, ERR_PARSING, (WynnItemList){0});
+
+    struct wynnitem_load_task tasks[WYNNITEM_LOAD_MAX_THREADS];
+    for (size_t i = 0; i < taskCount; i++)
+    {
+        pShards[i] = (WynnItemShard){wynnitem_pool_create(), wynnitem_name_pool_create()};
+        tasks[i] = (struct wynnitem_load_task){
+            .jsonString = jsonString + ranges[i].offset,
+            .length = ranges[i].length,
+            .pShard = &pShards[i],
+            .itemList = wynnitem_list_create(),
+        };
+    }
+    *pShardCountOut = taskCount;
+
+    // The calling thread takes the first slice
+    Thread threads[WYNNITEM_LOAD_MAX_THREADS];
+    for (size_t i = 1; i < taskCount; i++)
+    {
+        threads[i] = thread_start(wynnitem_load_task_run, &tasks[i]);
+    }
+    wynnitem_load_task_run(&tasks[0]);
+    for (size_t i = 1; i < taskCount; i++)
+    {
+        thread_wait(&threads[i]);
+    }
+
+    // Slices are in file order so appending them in task order keeps the original item order
+    bool isParsed = true;
+    size_t count = 0;
+    for (size_t i = 0; i < taskCount; i++)
+    {
+        isParsed &= tasks[i].isParsed;
+        count += wynnitem_list_size(&tasks[i].itemList);
+    }
+
+    WynnItemList itemList = wynnitem_list_create();
+    wynnitem_list_reserve(&itemList, count);
+    for (size_t i = 0; i < taskCount; i++)
+    {
+        for (size_t j = 0; isParsed && j < wynnitem_list_size(&tasks[i].itemList); j++)
+        {
+            wynnitem_list_append(&itemList, wynnitem_list_get(&tasks[i].itemList, j));
+        }
+        wynnitem_list_destroy(&tasks[i].itemList);
+    }
+
+    if (!isParsed)
+    {
+        wynnitem_list_destroy(&itemList);
+        ERR_RET(true, ERR_PARSING, (WynnItemList){0});
+    }
+
     return itemList;
 }
 
+// The cache is laid out so it can be used in place:
+// [header][section 0][section 1]...
+// Sections are 64 byte aligned and found through the header section table, so a reader
+// only touches the sections it needs. Item records nameOffset already points at its name
+// in the names section relative to the record position in the file.
+// Packed caches keep the same header and sections but store them as a varint stream
+// (see wynnitem_pack_item), they have to be decoded and are never mapped.
+#define WYNNITEM_BIN_MAGIC 0x494E5957u // "WYNI"
+#define WYNNITEM_BIN_VERSION 7
+#define WYNNITEM_BIN_ENDIAN_TAG 0x0102
+#define WYNNITEM_BIN_ALIGNMENT 64
+
+typedef enum
+{
+    WYNNITEM_BIN_SECTION_ITEMS = 0,
+    WYNNITEM_BIN_SECTION_NAMES = 1,
+    WYNNITEM_BIN_SECTION_COUNT,
+} WynnItemBinSection;
+
 #pragma pack(push, 1)
-struct wynnitem_bin_header
+struct wynnitem_bin_section
 {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t stride;
     uint32_t count;
+    uint64_t checksum;
 };
 
-struct wynnitem_bin_item 
+struct wynnitem_bin_header
 {
-    char name[64];
-    WynnItemType type;
-    WynnItemTier tier;
-    WynnItemClass class;
-    uint8_t powderSlots;
-    int32_t attackSpeed;
-    WynnItemIdArray idArray;
+    uint32_t magic;
+    uint16_t version;
+    uint16_t endianTag;
+    uint64_t schemaHash;
+    uint32_t count;
+    uint32_t sectionCount;
+    uint32_t encoding;  // WynnItemBinEncoding
+    struct wynnitem_bin_section sections[WYNNITEM_BIN_SECTION_COUNT];
+    uint64_t checksum; // Covers everything above with this field zeroed
 };
 #pragma pack(pop)
 
-static uint8_t* wynnitem_dump_bin(WynnItemList* pItemList, size_t* pSizeOut)
+static inline size_t bin_align(size_t offset)
+{
+    return (offset + WYNNITEM_BIN_ALIGNMENT - 1) & ~(size_t)(WYNNITEM_BIN_ALIGNMENT - 1);
+}
+
+static uint64_t bin_hash_names(uint64_t hash, const char** names, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        // Includes the terminator so ("ab", "c") and ("a", "bc") differ
+        hash = bin_hash(hash, names[i], strlen(names[i]) + 1);
+    }
+    return bin_hash(hash, &count, sizeof(count));
+}
+
+// Anything that changes how idArray or a record is laid out has to change this hash
+static uint64_t wynnitem_schema_hash()
+{
+    uint64_t hash = BIN_HASH_SEED;
+    hash = bin_hash_names(hash, wynnItemReqsNames, lengthof(wynnItemReqsNames));
+    hash = bin_hash_names(hash, wynnItemBaseNames, lengthof(wynnItemBaseNames));
+    hash = bin_hash_names(hash, wynnItemIdNames, lengthof(wynnItemIdNames));
+
+    uint64_t sizes[] = {WYNNITEM_ID_ARRAY_SIZE, sizeof(WynnItem), sizeof(WynnItemName)};
+    return bin_hash(hash, sizes, sizeof(sizes));
+}
+
+static uint64_t wynnitem_bin_header_checksum(struct wynnitem_bin_header* pHeader)
 {
-    size_t size = sizeof(struct wynnitem_bin_header);
-    size += wynnitem_list_size(pItemList) * sizeof(struct wynnitem_bin_item);
+    struct wynnitem_bin_header header = *pHeader;
+    header.checksum = 0;
+    return bin_hash(BIN_HASH_SEED, &header, sizeof(header));
+}
 
-    uint8_t* pBuffer = malloc(size);
+static void* wynnitem_bin_section(uint8_t* pData, WynnItemBinSection section)
+{
+    struct wynnitem_bin_header* pHeader = (struct wynnitem_bin_header*)pData;
+    return pData + pHeader->sections[section].offset;
+}
+
+static WynnItemBinEncoding wynnitem_bin_encoding(uint8_t* pData)
+{
+    return ((struct wynnitem_bin_header*)pData)->encoding;
+}
+
+/// Returns NULL if the cache can be used, otherwise the reason it is stale
+static const char* wynnitem_bin_check(uint8_t* pData, size_t size, bool checkPayload)
+{
+    if (pData == NULL || size < sizeof(struct wynnitem_bin_header)) return "truncated header";
+
+    struct wynnitem_bin_header* pHeader = (struct wynnitem_bin_header*)pData;
+    if (pHeader->magic != WYNNITEM_BIN_MAGIC) return "bad magic";
+    if (pHeader->endianTag != WYNNITEM_BIN_ENDIAN_TAG) return "endianness mismatch";
+    if (pHeader->version != WYNNITEM_BIN_VERSION) return "version mismatch";
+    if (pHeader->checksum != wynnitem_bin_header_checksum(pHeader)) return "header checksum mismatch";
+    if (pHeader->schemaHash != wynnitem_schema_hash()) return "schema hash mismatch";
+    if (pHeader->sectionCount != WYNNITEM_BIN_SECTION_COUNT) return "section count mismatch";
+    if (pHeader->encoding != WYNNITEM_BIN_ENCODING_RAW && 
+        pHeader->encoding != WYNNITEM_BIN_ENCODING_PACKED) return "unknown encoding";
+
+    // Packed sections are variable length streams without a stride
+    bool isRaw = pHeader->encoding == WYNNITEM_BIN_ENCODING_RAW;
+    size_t strides[WYNNITEM_BIN_SECTION_COUNT] = {
+        [WYNNITEM_BIN_SECTION_ITEMS] = isRaw ? sizeof(WynnItem) : 0,
+        [WYNNITEM_BIN_SECTION_NAMES] = isRaw ? sizeof(WynnItemName) : 0,
+    };
+    for (size_t i = 0; i < WYNNITEM_BIN_SECTION_COUNT; i++)
+    {
+        struct wynnitem_bin_section* pSection = &pHeader->sections[i];
+        if (pSection->offset % WYNNITEM_BIN_ALIGNMENT != 0) return "misaligned section";
+        if (pSection->offset > size || pSection->size > size - pSection->offset) return "truncated section";
+        if (pSection->stride != strides[i] || pSection->count != pHeader->count) return "section layout mismatch";
+        if ((uint64_t)pSection->stride * pSection->count > pSection->size) return "truncated section";
+        if (checkPayload && 
+            pSection->checksum != bin_hash(BIN_HASH_SEED, pData + pSection->offset, pSection->size)) 
+            return "section checksum mismatch";
+    }
+
+    return NULL;
+}
+
+// Varint streams for the packed encoding, LEB128 with zigzag for signed values
+typedef struct
+{
+    const uint8_t* p;
+    const uint8_t* end;
+} WynnItemBinReader;
+
+#define BIN_VARINT_MAX 5
+
+static inline uint8_t* bin_put_varint(uint8_t* p, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static inline uint8_t* bin_put_zigzag(uint8_t* p, int32_t value)
+{
+    return bin_put_varint(p, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static inline bool bin_get_varint(WynnItemBinReader* pReader, uint32_t* pValueOut)
+{
+    uint32_t value = 0;
+    for (uint32_t shift = 0; shift < 7 * BIN_VARINT_MAX; shift += 7)
+    {
+        if (pReader->p >= pReader->end) return false;
+        uint8_t byte = *pReader->p++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            *pValueOut = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool bin_get_zigzag(WynnItemBinReader* pReader, int32_t* pValueOut)
+{
+    uint32_t value = 0;
+    if (!bin_get_varint(pReader, &value)) return false;
+    *pValueOut = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    return true;
+}
+
+// Packed item record:
+// [type][tier][class][powderSlots][attackSpeed zigzag][non zero stat count]
+// then per non zero stat [index gap from the previous one][value zigzag].
+// Most items only have a handful of the idArray stats so this is mostly the pairs.
+#define WYNNITEM_PACKED_ITEM_MAX (5 * BIN_VARINT_MAX + WYNNITEM_ID_ARRAY_SIZE * 2 * BIN_VARINT_MAX)
+
+static uint8_t* wynnitem_pack_item(uint8_t* p, WynnItem* pItem)
+{
+    p = bin_put_varint(p, (uint32_t)pItem->type);
+    p = bin_put_varint(p, (uint32_t)pItem->tier);
+    p = bin_put_varint(p, (uint32_t)pItem->class);
+    p = bin_put_varint(p, pItem->powderSlots);
+    p = bin_put_zigzag(p, pItem->attackSpeed);
+
+    uint32_t statCount = 0;
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+        statCount += pItem->idArray[i] != 0;
+    p = bin_put_varint(p, statCount);
+
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        if (pItem->idArray[i] == 0) continue;
+        p = bin_put_varint(p, i - next);
+        p = bin_put_zigzag(p, pItem->idArray[i]);
+        next = i + 1;
+    }
+    return p;
+}
+
+static bool wynnitem_unpack_item(WynnItemBinReader* pReader, WynnItem* pItemOut)
+{
+    uint32_t type, tier, class, powderSlots, statCount;
+    if (!bin_get_varint(pReader, &type) || !bin_get_varint(pReader, &tier) ||
+        !bin_get_varint(pReader, &class) || !bin_get_varint(pReader, &powderSlots) ||
+        !bin_get_zigzag(pReader, &pItemOut->attackSpeed) || !bin_get_varint(pReader, &statCount))
+        return false;
+    if (statCount > WYNNITEM_ID_ARRAY_SIZE) return false;
+
+    pItemOut->type = (WynnItemType)type;
+    pItemOut->tier = (WynnItemTier)tier;
+    pItemOut->class = (WynnItemClass)class;
+    pItemOut->powderSlots = (uint8_t)powderSlots;
+    memset(pItemOut->idArray, 0, sizeof(pItemOut->idArray));
+
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < statCount; i++)
+    {
+        uint32_t gap = 0;
+        if (!bin_get_varint(pReader, &gap)) return false;
+        if (gap >= WYNNITEM_ID_ARRAY_SIZE - next) return false;
+        next += gap;
+        if (!bin_get_zigzag(pReader, &pItemOut->idArray[next])) return false;
+        next++;
+    }
+    return true;
+}
+
+static uint8_t* wynnitem_dump_bin(
+    WynnItemList* pItemList, 
+    WynnItemBinEncoding encoding, 
+    size_t* pSizeOut)
+{
+    size_t count = wynnitem_list_size(pItemList);
+    bool isRaw = encoding == WYNNITEM_BIN_ENCODING_RAW;
+
+    // Packed sections are sized for the worst case and the file is cut to what was written
+    size_t itemsOffset = bin_align(sizeof(struct wynnitem_bin_header));
+    size_t itemsSize = count * (isRaw ? sizeof(WynnItem) : WYNNITEM_PACKED_ITEM_MAX);
+    size_t namesOffset = bin_align(itemsOffset + itemsSize);
+    size_t namesSize = count * (isRaw ? sizeof(WynnItemName) : BIN_VARINT_MAX + sizeof(WynnItemName));
+    size_t size = namesOffset + namesSize;
+
+    uint8_t* pBuffer = calloc(1, size);
+    ERR_RET(pBuffer == NULL, ERR_FAILURE, NULL);
     struct wynnitem_bin_header* pHeader = (struct wynnitem_bin_header*)pBuffer;
-    struct wynnitem_bin_item* pItemArray = (struct wynnitem_bin_item*)(pBuffer + sizeof(struct wynnitem_bin_header));
 
-    pHeader->count = (uint32_t)wynnitem_list_size(pItemList);
+    if (isRaw)
+    {
+        WynnItem* pItemArray = (WynnItem*)(pBuffer + itemsOffset);
+        WynnItemName* pNameArray = (WynnItemName*)(pBuffer + namesOffset);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            WynnItem* pItem = wynnitem_list_get(pItemList, i);
+            WynnItem* pBinItem = pItemArray + i;
+            WynnItemName* pBinName = pNameArray + i;
 
-    for (size_t i = 0; i < wynnitem_list_size(pItemList); i++)
+            strncpy_s(
+                pBinName->str, sizeof(pBinName->str), 
+                wynnitem_name(pItem)->str, sizeof(pBinName->str) - 1
+            );
+            pBinItem->type = pItem->type;
+            pBinItem->tier = pItem->tier;
+            pBinItem->class = pItem->class;
+            pBinItem->powderSlots = pItem->powderSlots;
+            pBinItem->attackSpeed = pItem->attackSpeed;
+            memcpy_s(
+                pBinItem->idArray, sizeof(pBinItem->idArray), 
+                pItem->idArray, sizeof(pItem->idArray)
+            );
+            wynnitem_name_set(pBinItem, pBinName);
+        }
+    }
+    else
     {
-        WynnItem* pItem = wynnitem_list_get(pItemList, i);
-        struct wynnitem_bin_item* pBinItem = pItemArray + i;
-        strncpy_s(
-            pBinItem->name, sizeof(pBinItem->name), 
-            pItem->pName->str, sizeof(pItem->pName->str)
-        );
-        pBinItem->type = pItem->type;
-        pBinItem->tier = pItem->tier;
-        pBinItem->powderSlots = pItem->powderSlots;
-        pBinItem->attackSpeed = pItem->attackSpeed;
-        pBinItem->class = pItem->class;
-        memcpy_s(
-            pBinItem->idArray, sizeof(pBinItem->idArray), 
-            pItem->idArray, sizeof(pItem->idArray)
-        );
+        uint8_t* pItemEnd = pBuffer + itemsOffset;
+        for (size_t i = 0; i < count; i++)
+            pItemEnd = wynnitem_pack_item(pItemEnd, wynnitem_list_get(pItemList, i));
+        itemsSize = (size_t)(pItemEnd - (pBuffer + itemsOffset));
+
+        // Names move up right behind the items
+        namesOffset = bin_align(itemsOffset + itemsSize);
+        uint8_t* pNameEnd = pBuffer + namesOffset;
+        for (size_t i = 0; i < count; i++)
+        {
+            const char* name = wynnitem_name(wynnitem_list_get(pItemList, i))->str;
+            size_t length = strnlen(name, sizeof(WynnItemName) - 1);
+            pNameEnd = bin_put_varint(pNameEnd, (uint32_t)length);
+            memcpy(pNameEnd, name, length);
+            pNameEnd += length;
+        }
+        namesSize = (size_t)(pNameEnd - (pBuffer + namesOffset));
+        size = namesOffset + namesSize;
     }
 
+    pHeader->magic = WYNNITEM_BIN_MAGIC;
+    pHeader->version = WYNNITEM_BIN_VERSION;
+    pHeader->endianTag = WYNNITEM_BIN_ENDIAN_TAG;
+    pHeader->schemaHash = wynnitem_schema_hash();
+    pHeader->count = (uint32_t)count;
+    pHeader->sectionCount = WYNNITEM_BIN_SECTION_COUNT;
+    pHeader->encoding = encoding;
+    pHeader->sections[WYNNITEM_BIN_SECTION_ITEMS] = (struct wynnitem_bin_section){
+        itemsOffset, itemsSize, isRaw ? sizeof(WynnItem) : 0, (uint32_t)count, 
+        bin_hash(BIN_HASH_SEED, pBuffer + itemsOffset, itemsSize)
+    };
+    pHeader->sections[WYNNITEM_BIN_SECTION_NAMES] = (struct wynnitem_bin_section){
+        namesOffset, namesSize, isRaw ? sizeof(WynnItemName) : 0, (uint32_t)count, 
+        bin_hash(BIN_HASH_SEED, pBuffer + namesOffset, namesSize)
+    };
+    pHeader->checksum = wynnitem_bin_header_checksum(pHeader);
+
     if (pSizeOut != NULL)
         *pSizeOut = size;
 
     return pBuffer;
 }
 
+static WynnItemList wynnitem_unpack_bin(
+    uint8_t* pData,
+    WynnItemPool* pItemPool, 
+    WynnItemNamePool* pNamePool)
+{
+    WynnItemList itemList = wynnitem_list_create();
+
+    struct wynnitem_bin_header* pHeader = (struct wynnitem_bin_header*)pData;
+    struct wynnitem_bin_section* pItems = &pHeader->sections[WYNNITEM_BIN_SECTION_ITEMS];
+    struct wynnitem_bin_section* pNames = &pHeader->sections[WYNNITEM_BIN_SECTION_NAMES];
+    WynnItemBinReader itemReader = {pData + pItems->offset, pData + pItems->offset + pItems->size};
+    WynnItemBinReader nameReader = {pData + pNames->offset, pData + pNames->offset + pNames->size};
+    wynnitem_list_reserve(&itemList, pHeader->count);
+
+    for (size_t i = 0; i < pHeader->count; i++)
+    {
+        WynnItem* pItem = wynnitem_pool_alloc(pItemPool);
+        WynnItemName* pName = wynnitem_name_pool_alloc(pNamePool);
+
+        uint32_t length = 0;
+        bool isValid = wynnitem_unpack_item(&itemReader, pItem) && 
+            bin_get_varint(&nameReader, &length) && length < sizeof(pName->str) && 
+            length <= (size_t)(nameReader.end - nameReader.p);
+        if (!isValid)
+        {
+            wynnitem_list_destroy(&itemList);
+            ERR_RET(true, ERR_PARSING, (WynnItemList){0});
+        }
+
+        memcpy(pName->str, nameReader.p, length);
+        pName->str[length] = '\0';
+        nameReader.p += length;
+        wynnitem_name_set(pItem, pName);
+
+        wynnitem_list_append(&itemList, pItem);
+    }
+
+    return itemList;
+}
+
 static WynnItemList wynnitem_load_bin(
     uint8_t* pData,
+    size_t size,
     WynnItemPool* pItemPool, 
     WynnItemNamePool* pNamePool)
 {
+    if (wynnitem_bin_encoding(pData) == WYNNITEM_BIN_ENCODING_PACKED)
+        return wynnitem_unpack_bin(pData, pItemPool, pNamePool);
+
     WynnItemList itemList = wynnitem_list_create();
 
-    struct wynnitem_bin_header header = *(struct wynnitem_bin_header*)pData;
-    pData += sizeof(struct wynnitem_bin_header);
+    struct wynnitem_bin_header* pHeader = (struct wynnitem_bin_header*)pData;
+    WynnItem* pBinItems = wynnitem_bin_section(pData, WYNNITEM_BIN_SECTION_ITEMS);
+    wynnitem_list_reserve(&itemList, pHeader->count);
 
-    for (size_t i = 0; i < header.count; i++)
+    for (size_t i = 0; i < pHeader->count; i++)
     {
-        struct wynnitem_bin_item* pBinItem = ((struct wynnitem_bin_item*)pData) + i;
+        WynnItem* pBinItem = pBinItems + i;
         WynnItem* pItem = wynnitem_pool_alloc(pItemPool);
-        pItem->pName = wynnitem_name_pool_alloc(pNamePool);
-        strncpy_s(
-            pItem->pName->str, sizeof(pItem->pName->str), 
-            pBinItem->name, sizeof(pBinItem->name)
-        );
-        pItem->type = pBinItem->type;
-        pItem->tier = pBinItem->tier;
-        pItem->powderSlots = pBinItem->powderSlots;
-        pItem->attackSpeed = pBinItem->attackSpeed;
-        memcpy_s(
-            pItem->idArray, sizeof(pItem->idArray), 
-            pBinItem->idArray, sizeof(pItem->idArray)
-        );
+        *pItem = *pBinItem;
+
+        WynnItemName* pName = wynnitem_name_pool_alloc(pNamePool);
+        *pName = *wynnitem_name(pBinItem);
+        wynnitem_name_set(pItem, pName);
 
         wynnitem_list_append(&itemList, pItem);
     }
 
     return itemList;
-}
\ No newline at end of file
+}
+
+// Record i's name is name i of the names section, and wynnitem_bin_check already checked the strides,
+// counts and bounds of both sections. Payloads aren't checksummed when mapping, so only the first
+// and last record are checked to point where the layout says. No other item or name page is read
+// before it is used.
+static bool wynnitem_map_name_valid(uint8_t* pData, WynnItem* pBinItems, size_t i)
+{
+    struct wynnitem_bin_header* pHeader = (struct wynnitem_bin_header*)pData;
+    uint64_t itemOffset = pHeader->sections[WYNNITEM_BIN_SECTION_ITEMS].offset + i * sizeof(WynnItem);
+    uint64_t nameOffset = pHeader->sections[WYNNITEM_BIN_SECTION_NAMES].offset + i * sizeof(WynnItemName);
+    return pBinItems[i].nameOffset == (int64_t)nameOffset - (int64_t)itemOffset;
+}
+
+static WynnItemList wynnitem_map_bin(uint8_t* pData)
+{
+    struct wynnitem_bin_header* pHeader = (struct wynnitem_bin_header*)pData;
+    WynnItem* pBinItems = wynnitem_bin_section(pData, WYNNITEM_BIN_SECTION_ITEMS);
+    size_t count = pHeader->count;
+    bool isLayoutValid = count == 0 ||
+        (wynnitem_map_name_valid(pData, pBinItems, 0) && wynnitem_map_name_valid(pData, pBinItems, count - 1));
+    ERR_RET(!isLayoutValid, ERR_PARSING, (WynnItemList){0});
+
+    WynnItemList itemList = wynnitem_list_create();
+    wynnitem_list_reserve(&itemList, count);
+    for (size_t i = 0; i < count; i++) wynnitem_list_append(&itemList, pBinItems + i);
+
+    return itemList;
+}
+
+static bool wynnitem_mapping_open(WynnItemMapping* pMapping, const char* path)
+{
+    *pMapping = (WynnItemMapping){0};
+
+#ifdef PLATFORM_WINDOWS
+    HANDLE file = CreateFileA(
+        path, GENERIC_READ, FILE_SHARE_READ, NULL, 
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    ERR_RET(file == INVALID_HANDLE_VALUE, ERR_IO_FAILED, false);
+
+    LARGE_INTEGER fileSize = {0};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        ERR_RET(true, ERR_IO_FAILED, false);
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        ERR_RET(true, ERR_IO_FAILED, false);
+    }
+
+    void* pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (pView == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        ERR_RET(true, ERR_IO_FAILED, false);
+    }
+
+    pMapping->pData = pView;
+    pMapping->size = (size_t)fileSize.QuadPart;
+    pMapping->file = file;
+    pMapping->mapping = mapping;
+#elif defined(PLATFORM_UNIX)
+    int fd = open(path, O_RDONLY);
+    ERR_RET(fd < 0, ERR_IO_FAILED, false);
+
+    struct stat fileStat = {0};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(fd);
+        ERR_RET(true, ERR_IO_FAILED, false);
+    }
+
+    // MAP_SHARED so every process mapping the cache reuses the same page cache copy
+    void* pView = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    ERR_RET(pView == MAP_FAILED, ERR_IO_FAILED, false);
+
+    pMapping->pData = pView;
+    pMapping->size = (size_t)fileStat.st_size;
+#else
+#error Memory mapping not supported!
+#endif
+
+    return true;
+}
+
+static void wynnitem_mapping_close(WynnItemMapping* pMapping)
+{
+    if (pMapping->pData == NULL) return;
+
+#ifdef PLATFORM_WINDOWS
+    UnmapViewOfFile(pMapping->pData);
+    CloseHandle(pMapping->mapping);
+    CloseHandle(pMapping->file);
+#elif defined(PLATFORM_UNIX)
+    munmap(pMapping->pData, pMapping->size);
+#endif
+
+    *pMapping = (WynnItemMapping){0};
+}
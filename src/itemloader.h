@@ -3,7 +3,64 @@
 
 #include "wynnitems.h"
 
-WynnItemList* wynnitems_load(char* dbBinPath, char* dbUrl);
+typedef enum
+{
+    WYNNITEM_LOAD_COPY = 0,     // Copies every item out of the cache into the item pools
+    WYNNITEM_LOAD_MAPPED = 1,   // Maps the cache read only and points items straight into it
+    WYNNITEM_LOAD_PACKED = 2,   // Keeps the cache compressed on disk and decodes it into the item pools
+} WynnItemLoadMode;
+
+typedef struct
+{
+    WynnItemList removed;   // Items that are gone or changed, readable until wynnitem_diff_destroy
+    WynnItemList added;     // Items that are new and the new version of changed ones
+} WynnItemDiff;
+
+WynnItemList* wynnitems_load(char* dbBinPath, char* dbUrl, WynnItemLoadMode loadMode);
 void wynnitems_unload();
 
+/// @brief Downloads the database again and diffs it by name against the loaded items, unchanged
+//  items keep their pointers and the cache is rewritten only if anything changed. A cache that
+//  can't be rewritten is removed. Fails on Windows after a WYNNITEM_LOAD_MAPPED load, the mapped
+//  cache can't be replaced there.
+/// @param[in] dbBinPath Cache path given to wynnitems_load
+/// @param[in] dbUrl Database url
+/// @param[out] pDiffOut Removed and added items, pass it to wynnitems_update then wynnitem_diff_destroy
+/// @return The loaded item list (same as wynnitems_load), NULL on failure
+WynnItemList* wynnitems_refresh(char* dbBinPath, char* dbUrl, WynnItemDiff* pDiffOut);
+
+/// @brief Rewrites the cache from the loaded items
+/// @param[in] dbBinPath Cache path given to wynnitems_load
+/// @return TRUE if the cache was replaced
+bool wynnitems_save(char* dbBinPath);
+
+typedef struct WynnItemNameHash WynnItemNameHash;
+/// @brief Normalized name to item table of the loaded items (built on the first call after a load or wynnitems_refresh)
+/// @return Table valid until wynnitems_refresh or wynnitems_unload, NULL if nothing is loaded
+WynnItemNameHash* wynnitems_name_hash();
+
+typedef struct WynnItemNameTable WynnItemNameTable;
+/// @brief Normalized names of the loaded items, rows are positions in the loaded item list
+//  (built on the first call after a load or wynnitems_refresh)
+/// @return Table valid until wynnitems_refresh or wynnitems_unload, NULL if nothing is loaded
+WynnItemNameTable* wynnitems_name_table();
+
+typedef struct WynnItemTokenIndex WynnItemTokenIndex;
+/// @brief Name word index of the loaded items, rows are positions in the loaded item list
+//  (built on the first call after a load or wynnitems_refresh)
+/// @return Index valid until wynnitems_refresh or wynnitems_unload, NULL if nothing is loaded
+WynnItemTokenIndex* wynnitems_token_index();
+
+/// @brief Frees a diff and the removed items (call before wynnitems_unload)
+/// @param[in] pDiff Diff from wynnitems_refresh
+void wynnitem_diff_destroy(WynnItemDiff* pDiff);
+
+/// @brief Round trips a list through the raw and the packed cache encoding and prints sizes and timings,
+//  both for decoding from memory and for loading from a file including the read or the mapping
+/// @param[in] pItemList Items to encode
+/// @param[in] scratchPath File the caches are written to for the load timings, removed afterwards
+/// @param iterations Loads timed per encoding
+/// @return TRUE if both encodings load back to the same items
+bool wynnitems_cache_benchmark(WynnItemList* pItemList, char* scratchPath, size_t iterations);
+
 #endif // ITEMLOADER_H
\ No newline at end of file
@@ -1,8 +1,13 @@
 #include "itemsearch.h"
 #include <string.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include "wynnitems.h"
 #include "itemloader.h"
+#include "levenshteinbatch.h"
+#include "nameindex.h"
+#include "levenshteintree.h"
+#include "nametokens.h"
 
 // ################################################################################
 // Levenshtein distance
@@ -50,25 +55,130 @@ uint32_t levenshtein(char* str, char* testStr)
     return array[strBLen - 1];
 }
 
-static int levenshtein_cmp(
-    const struct levenshtein_item* pItemA, 
-    const struct levenshtein_item* pItemB)
+// ################################################################################
+// Bit-parallel Levenshtein distance
+// "A bit-vector algorithm for computing Levenshtein and Damerau edit distances"
+// Hyyro 2003, global distance variant of Myers 1999
+//
+// ################################################################################
+
+LevenshteinPattern levenshtein_pattern(const char* str)
+{
+    LevenshteinPattern pattern = {0};
+    pattern.length = strnlen(str, sizeof(WynnItemName) - 1);
+    for (uint32_t i = 0; i < pattern.length; i++)
+    {
+        pattern.peq[(uint8_t)str[i]] |= 1ULL << i;
+    }
+    pattern.lastBit = pattern.length > 0 ? 1ULL << (pattern.length - 1) : 0;
+    pattern.classes = wynnitem_name_classes(str, pattern.length);
+
+    return pattern;
+}
+
+uint32_t levenshtein_myers(const LevenshteinPattern* pPattern, const char* testStr)
+{
+    return levenshtein_myers_sized(pPattern, testStr, strnlen(testStr, sizeof(WynnItemName)));
+}
+
+// Keeps the last DP column as vertical +1/-1 deltas in two words, one text byte per step
+uint32_t levenshtein_myers_sized(const LevenshteinPattern* pPattern, const char* testStr, size_t testLength)
+{
+    if (pPattern->length == 0) return testLength;
+
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    uint32_t score = pPattern->length;
+    for (size_t j = 0; j < testLength; j++)
+    {
+        uint64_t eq = pPattern->peq[(uint8_t)testStr[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        score += (ph & pPattern->lastBit) != 0;
+        score -= (mh & pPattern->lastBit) != 0;
+
+        // Top row is j, every column starts one higher
+        ph = ph << 1 | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    return score;
+}
+
+// The score is the distance to the text read so far, so its minimum is the closest prefix
+uint32_t levenshtein_myers_prefix(const LevenshteinPattern* pPattern, const char* testStr, size_t testLength)
 {
-    return pItemA->distance < pItemB->distance ? -1 : 1;
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    uint32_t score = pPattern->length;
+    uint32_t best = score;
+    for (size_t j = 0; j < testLength && best > 0; j++)
+    {
+        uint64_t eq = pPattern->peq[(uint8_t)testStr[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        score += (ph & pPattern->lastBit) != 0;
+        score -= (mh & pPattern->lastBit) != 0;
+        best = score < best ? score : best;
+
+        ph = ph << 1 | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    return best;
 }
 
-LevenshteinHeap levenshtein_sorted(char* itemName, WynnItemList* pItemList)
+uint32_t levenshtein_myers_bounded(const LevenshteinPattern* pPattern, const char* testStr, uint32_t maxDist)
 {
-    LevenshteinHeap heap = levenshtein_heap_create(levenshtein_cmp);
+    size_t testLength = strnlen(testStr, sizeof(WynnItemName));
+    uint32_t lengthGap = testLength > pPattern->length ? testLength - pPattern->length : pPattern->length - testLength;
+    if (lengthGap > maxDist) return maxDist + 1;
+    if (pPattern->length == 0) return testLength;
 
-    WynnItem* pItem = NULL;
-    while (wynnitem_list_iter_next(pItemList, &pItem))
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    uint32_t score = pPattern->length;
+    for (size_t j = 0; j < testLength; j++)
     {
-        float score = levenshtein(itemName, pItem->pName->str);
-        levenshtein_heap_push(&heap, (struct levenshtein_item){score, pItem});
+        uint64_t eq = pPattern->peq[(uint8_t)testStr[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        score += (ph & pPattern->lastBit) != 0;
+        score -= (mh & pPattern->lastBit) != 0;
+
+        // Each remaining column lowers the score by at most one
+        if (score > maxDist + (testLength - j - 1)) return maxDist + 1;
+
+        ph = ph << 1 | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
     }
 
-    return heap;
+    return score;
+}
+
+LevenshteinTop levenshtein_sorted(char* itemName, LevenshteinBatch* pBatch, WorkerPool* pPool)
+{
+    LevenshteinTop top = levenshtein_top_create();
+    LevenshteinPattern pattern = levenshtein_pattern(itemName);
+    if (pPool != NULL) levenshtein_batch_top_parallel(&pattern, pBatch, pPool, &top);
+    else levenshtein_batch_top(&pattern, pBatch, &top);
+
+    return top;
 }
 
 // ################################################################################
@@ -79,97 +189,153 @@ LevenshteinHeap levenshtein_sorted(char* itemName, WynnItemList* pItemList)
 
 
 
-static int wynnitem_score_cmp(const struct scored_item* pItemA, const struct scored_item* pItemB)
+void scored_items_print(WynnItem* pSearchItem, WynnItemList* pItemList)
 {
-    return pItemA->score < pItemB->score ? -1 : 1;
+    // One extra for the search item itself, it is its own closest item. The precomputed
+    // neighbours are a lookup, the tree is only searched if they aren't there.
+    WynnItem* ppItems[SCORED_ITEM_TOP_COUNT + 1];
+    float distances[SCORED_ITEM_TOP_COUNT + 1];
+    size_t itemCount = wynnitem_neighbours(pSearchItem, SCORED_ITEM_TOP_COUNT + 1, ppItems, distances);
+    if (itemCount == 0) itemCount = wynnitem_knn(pSearchItem, SCORED_ITEM_TOP_COUNT + 1, ppItems, distances);
+
+    size_t printCount = 0;
+    for (size_t i = 0; i < itemCount && printCount < SCORED_ITEM_TOP_COUNT; i++)
+    {
+        if (!strcmp(wynnitem_name(ppItems[i])->str, wynnitem_name(pSearchItem)->str)) continue;
+        printf("  %s %f\n", wynnitem_name(ppItems[i])->str, distances[i]);
+        printCount++;
+    }
+    printf("\n");
 }
 
-void scored_items_print(WynnItem* pSearchItem, WynnItemList* pItemList)
+// Tree searches that would score more than 1 / SEARCH_TREE_VISIT_FRACTION of the names give up
+// and the batch is scanned in parallel instead
+#define SEARCH_TREE_VISIT_FRACTION 4
+
+// Name lookups of one search session, the indexes come from the loader
+struct item_search
+{
+    bool isIndexed;
+    WynnItemList* pItemList;
+    WynnItemNameHash* pNameHash;
+    WynnItemTokenIndex* pTokenIndex;
+    LevenshteinTree nameTree;
+    LevenshteinBatch nameBatch;
+    WorkerPool* pPool;
+};
+
+// Multi word queries are matched word by word, so fragments in any order still find the name
+static size_t search_tokens(struct item_search* pSearch, const char* query, WynnItem** ppMatchesOut)
 {
-    ItemScoreHeap itemScores = itemscore_heap_create(wynnitem_score_cmp);
-    WynnItem* pItem = NULL;
-    while (wynnitem_list_iter_next(pItemList, &pItem))
+    if (pSearch->pTokenIndex == NULL || wynnitem_token_count(query) < 2) return 0;
+
+    TokenMatchTop top = token_match_top_create();
+    wynnitem_token_index_match(pSearch->pTokenIndex, pSearch->pItemList, query, &top);
+    struct scored_item matches[WYNNITEM_TOKEN_TOP_COUNT];
+    token_match_top_to_array(&top, matches);
+
+    size_t matchCount = token_match_top_size(&top);
+    for (size_t i = 0; i < matchCount; i++) ppMatchesOut[i] = matches[i].pItem;
+    return matchCount;
+}
+
+static size_t search_names(struct item_search* pSearch, const char* query, struct levenshtein_item* pMatchesOut)
+{
+    size_t matchCount = 0;
+    size_t maxVisits = pSearch->nameTree.count / SEARCH_TREE_VISIT_FRACTION + 1;
+    LevenshteinHeap levenshteinHeap = levenshtein_tree_k_nearest(&pSearch->nameTree, query, LEVENSHTEIN_TOP_COUNT, maxVisits);
+    for (; matchCount < LEVENSHTEIN_TOP_COUNT && levenshtein_heap_size(&levenshteinHeap) > 0; matchCount++)
     {
-        float score = wynnitem_similarity(pSearchItem, pItem);
-        itemscore_heap_push(&itemScores, (struct scored_item){score, pItem});
+        pMatchesOut[matchCount] = levenshtein_heap_pop(&levenshteinHeap);
     }
+    levenshtein_heap_destroy(&levenshteinHeap);
+    if (matchCount > 0) return matchCount;
 
-    for (int i = 0; itemscore_heap_size(&itemScores) > 0 && i < 20;)
-    {
-        struct scored_item scoredItem = itemscore_heap_pop(&itemScores);
-        if (scoredItem.pItem->type != pSearchItem->type) continue;
-        if (!strcmp(scoredItem.pItem->pName->str, pSearchItem->pName->str)) continue;
+    LevenshteinTop top = levenshtein_sorted((char*)query, &pSearch->nameBatch, pSearch->pPool);
+    levenshtein_top_to_array(&top, pMatchesOut);
+    return levenshtein_top_size(&top);
+}
 
-        printf("  %s %f\n", scoredItem.pItem->pName->str, scoredItem.score);
-        i++;
-    }
-    printf("\n");
-    itemscore_heap_destroy(&itemScores);
+// Names are indexed on the first search, so starting up never reads every name. A query only
+// visits the subtrees that can hold a closer name, queries the tree can't prune fall back to
+// scanning the packed names on every core.
+static bool item_search_index(struct item_search* pSearch)
+{
+    if (pSearch->isIndexed) return true;
+
+    WynnItemNameTable* pNameTable = wynnitems_name_table();
+    ERR_RET(pNameTable == NULL, ERR_FAILURE, false);
+    pSearch->pNameHash = wynnitems_name_hash();
+    pSearch->pTokenIndex = wynnitems_token_index();
+    pSearch->nameTree = levenshtein_tree_create(pNameTable, pSearch->pItemList);
+    pSearch->nameBatch = levenshtein_batch_create(pNameTable, pSearch->pItemList);
+    pSearch->pPool = worker_pool_create(0);
+    pSearch->isIndexed = true;
+    return true;
 }
 
-static WynnItem* select_search_item(WynnItemList* pItemList)
+static WynnItem* select_search_item(struct item_search* pSearch)
 {
     printf("Search item: ");
     WynnItemName searchName = {0};
     fgets(searchName.str, sizeof(searchName.str), stdin);
     *strchr(searchName.str, '\n') = '\0';
+    if (!item_search_index(pSearch)) return NULL;
 
-    LevenshteinHeap levenshteinHeap = levenshtein_sorted(searchName.str, pItemList);
-    struct levenshtein_item levenshteinItem = levenshtein_heap_peek(&levenshteinHeap);
-    WynnItem* pBestMatchItem = levenshteinItem.pItem;
-    uint32_t lowestDist = levenshteinItem.distance;
+    // Typing a name as it is spelled, give or take case and spaces, never needs the fuzzy search
+    WynnItem* pExactItem = pSearch->pNameHash != NULL ? wynnitem_name_hash_find(pSearch->pNameHash, searchName.str) : NULL;
+    if (pExactItem != NULL) return pExactItem;
 
-    if (lowestDist == 0)
+    // The indexes hold normalized names
+    WynnItemName query;
+    wynnitem_name_normalize(searchName.str, &query);
+
+    WynnItem* ppMatches[LEVENSHTEIN_TOP_COUNT];
+    size_t matchCount = search_tokens(pSearch, query.str, ppMatches);
+    if (matchCount == 0)
     {
-        levenshtein_heap_destroy(&levenshteinHeap);
-        return pBestMatchItem;
+        struct levenshtein_item matches[LEVENSHTEIN_TOP_COUNT];
+        matchCount = search_names(pSearch, query.str, matches);
+        if (matchCount > 0 && matches[0].distance == 0) return matches[0].pItem;
+        for (size_t i = 0; i < matchCount; i++) ppMatches[i] = matches[i].pItem;
     }
+    if (matchCount == 0) return NULL;
 
-    for (;;)
+    for (size_t i = 0; i < matchCount; i++)
     {
-        WynnItem* pItems[8];
-        for (size_t i = 0; i < 8; i++)
-        {
-            pItems[i] = levenshtein_heap_pop(&levenshteinHeap).pItem;
-            printf("%zu %s\n", i + 1, pItems[i]->pName->str);
-        }
+        printf("%zu %s\n", i + 1, wynnitem_name(ppMatches[i])->str);
+    }
 
-        printf ("Did you mean? ([1-9]/n): ");
+    for (;;)
+    {
+        printf ("Did you mean? ([1-%zu]/n): ", matchCount);
         char answer[4]; 
         fgets(answer, sizeof(answer), stdin);
-        WynnItem* pReturnItem = NULL;
 
         if (strnlen(answer, sizeof(answer)) > 2)
-        {
             printf("Input is more than a single char!\n");
-            continue;
-        }
         else if (strnlen(answer, sizeof(answer)) < 2)
-            pReturnItem = pItems[0];
-        else if (answer[0] >= '1' && answer[0] <= '8')
-            pReturnItem = pItems[answer[0] - '1'];
+            return ppMatches[0];
+        else if (answer[0] >= '1' && answer[0] < '1' + (char)matchCount)
+            return ppMatches[answer[0] - '1'];
         else if (tolower(answer[0]) == 'n')
-            pReturnItem = NULL;
+            return NULL;
         else
-        {
-            printf("Input is not 1-9 or 'n'!\n");
-            continue;
-        }
-        
-        levenshtein_heap_destroy(&levenshteinHeap);
-
-        return pReturnItem;
+            printf("Input is not 1-%zu or 'n'!\n", matchCount);
     }
 }
 
 void itemsearch_start(WynnItemList* pItemList)
 {
+    struct item_search search = {0};
+    search.pItemList = pItemList;
+
     for (;;)
     {
-        WynnItem* pSearchItem = select_search_item(pItemList);
+        WynnItem* pSearchItem = select_search_item(&search);
         if (pSearchItem == NULL) continue;
 
-        printf("Selected: '%s'\n", pSearchItem->pName->str);
+        printf("Selected: '%s'\n", wynnitem_name(pSearchItem)->str);
         scored_items_print(pSearchItem, pItemList);
     }
-}
\ No newline at end of file
+}
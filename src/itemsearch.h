@@ -2,6 +2,8 @@
 #define ITEMSEARCH_H
 
 #include "wynnitems.h"
+#include "topk.h"
+#include "workerpool.h"
 
 struct levenshtein_item
 {
@@ -11,8 +13,57 @@ struct levenshtein_item
 
 HEAP_GENERIC_EX(struct levenshtein_item, LevenshteinHeap, levenshtein_heap);
 
+// Names offered by a "Did you mean?" list
+#define LEVENSHTEIN_TOP_COUNT 8
+
+static inline bool levenshtein_item_is_better(const struct levenshtein_item* pItemA, const struct levenshtein_item* pItemB)
+{
+    return pItemA->distance < pItemB->distance;
+}
+
+TOPK_GENERIC_EX(struct levenshtein_item, LevenshteinTop, levenshtein_top, LEVENSHTEIN_TOP_COUNT, levenshtein_item_is_better);
+
+// Per query state of the bit-parallel kernel, names fit in one word (WynnItemName is 64 bytes)
+typedef struct
+{
+    uint64_t peq[256];  // Bit i set where the pattern has that byte at position i
+    uint64_t lastBit;
+    uint64_t classes;   // wynnitem_name_classes of the pattern
+    uint32_t length;
+} LevenshteinPattern;
+
 uint32_t levenshtein(char* str, char* testStr);
-LevenshteinHeap levenshtein_sorted(char* itemName, WynnItemList* pItemList);
+LevenshteinPattern levenshtein_pattern(const char* str);
+uint32_t levenshtein_myers(const LevenshteinPattern* pPattern, const char* testStr);
+
+/// @brief levenshtein_myers of a candidate whose length is already known
+/// @param[in] pPattern Query from levenshtein_pattern
+/// @param[in] testStr Candidate, doesn't have to be NULL terminated
+/// @param testLength Bytes of testStr
+/// @return Edit distance
+uint32_t levenshtein_myers_sized(const LevenshteinPattern* pPattern, const char* testStr, size_t testLength);
+
+/// @brief Edit distance from the query to the closest prefix of a candidate
+/// @param[in] pPattern Query from levenshtein_pattern
+/// @param[in] testStr Candidate, doesn't have to be NULL terminated
+/// @param testLength Bytes of testStr
+/// @return Smallest edit distance to any prefix (the empty one and testStr itself included)
+uint32_t levenshtein_myers_prefix(const LevenshteinPattern* pPattern, const char* testStr, size_t testLength);
+
+/// @brief levenshtein_myers that gives up once the distance is sure to be over maxDist
+/// @param[in] pPattern Query from levenshtein_pattern
+/// @param[in] testStr NULL terminated candidate
+/// @param maxDist Largest distance of interest
+/// @return Edit distance, or maxDist + 1 if it is larger than maxDist
+uint32_t levenshtein_myers_bounded(const LevenshteinPattern* pPattern, const char* testStr, uint32_t maxDist);
+
+typedef struct LevenshteinBatch LevenshteinBatch;
+/// @brief The LEVENSHTEIN_TOP_COUNT closest names of a batch
+/// @param[in] itemName Query
+/// @param[in] pBatch Candidates
+/// @param[in] pPool Workers to scan shards of the batch on, NULL scans on the calling thread
+/// @return Closest items, read them best first with levenshtein_top_to_array
+LevenshteinTop levenshtein_sorted(char* itemName, LevenshteinBatch* pBatch, WorkerPool* pPool);
 
 struct scored_item
 {
@@ -20,7 +71,16 @@ struct scored_item
     WynnItem* pItem;
 };
 
-HEAP_GENERIC_EX(struct scored_item, ItemScoreHeap, itemscore_heap);
+// Recommendations printed for an item
+#define SCORED_ITEM_TOP_COUNT 20
+
+// Lower scores are closer
+static inline bool scored_item_is_better(const struct scored_item* pItemA, const struct scored_item* pItemB)
+{
+    return pItemA->score < pItemB->score;
+}
+
+TOPK_GENERIC_EX(struct scored_item, ItemScoreTop, itemscore_top, SCORED_ITEM_TOP_COUNT, scored_item_is_better);
 
 void scored_items_print(WynnItem* pSearchItem, WynnItemList* pItemList);
 void itemsearch_start(WynnItemList* pItemList);
@@ -0,0 +1,375 @@
+#include "jsonstream.h"
+#include <LTK/error_handling.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef enum
+{
+    JSON_STREAM_STATE_VALUE,
+    JSON_STREAM_STATE_KEY,
+    JSON_STREAM_STATE_AFTER_VALUE,
+} JsonStreamState;
+
+typedef struct
+{
+    const char* p;
+    const char* end;
+} JsonCursor;
+
+static inline void skip_whitespace(JsonCursor* pCursor)
+{
+    while (pCursor->p < pCursor->end)
+    {
+        char c = *pCursor->p;
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') break;
+        pCursor->p++;
+    }
+}
+
+static inline bool cursor_is(JsonCursor* pCursor, char c)
+{
+    return pCursor->p < pCursor->end && *pCursor->p == c;
+}
+
+static bool scan_string(JsonCursor* pCursor, JsonStreamValue* pValueOut)
+{
+    if (!cursor_is(pCursor, '"')) return false;
+    const char* start = ++pCursor->p;
+    bool escaped = false;
+
+    while (pCursor->p < pCursor->end && *pCursor->p != '"')
+    {
+        if (*pCursor->p == '\\')
+        {
+            escaped = true;
+            pCursor->p++;
+        }
+        pCursor->p++;
+    }
+    if (pCursor->p >= pCursor->end) return false;
+
+    *pValueOut = (JsonStreamValue){
+        .valueType = JSON_VALUE_TYPE_STRING,
+        .str = start,
+        .length = (size_t)(pCursor->p - start),
+        .escaped = escaped,
+    };
+    pCursor->p++;
+    return true;
+}
+
+static bool scan_number(JsonCursor* pCursor, JsonStreamValue* pValueOut)
+{
+    const char* start = pCursor->p;
+    while (pCursor->p < pCursor->end)
+    {
+        char c = *pCursor->p;
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) break;
+        pCursor->p++;
+    }
+
+    size_t length = (size_t)(pCursor->p - start);
+    char numberString[64];
+    if (length == 0 || length >= sizeof(numberString)) return false;
+    memcpy(numberString, start, length);
+    numberString[length] = '\0';
+
+    char* numberEnd = NULL;
+    double number = strtod(numberString, &numberEnd);
+    if (numberEnd != numberString + length) return false;
+
+    *pValueOut = (JsonStreamValue){
+        .valueType = JSON_VALUE_TYPE_NUMBER,
+        .str = start,
+        .length = length,
+        .number = number,
+    };
+    return true;
+}
+
+static bool scan_literal(JsonCursor* pCursor, const char* literal)
+{
+    size_t length = strlen(literal);
+    if ((size_t)(pCursor->end - pCursor->p) < length) return false;
+    if (memcmp(pCursor->p, literal, length)) return false;
+    pCursor->p += length;
+    return true;
+}
+
+static bool scan_scalar(JsonCursor* pCursor, JsonStreamValue* pValueOut)
+{
+    if (pCursor->p >= pCursor->end) return false;
+
+    switch (*pCursor->p)
+    {
+        case '"': return scan_string(pCursor, pValueOut);
+        case 't':
+            *pValueOut = (JsonStreamValue){.valueType = JSON_VALUE_TYPE_BOOL, .boolean = true};
+            return scan_literal(pCursor, "true");
+        case 'f':
+            *pValueOut = (JsonStreamValue){.valueType = JSON_VALUE_TYPE_BOOL, .boolean = false};
+            return scan_literal(pCursor, "false");
+        case 'n':
+            *pValueOut = (JsonStreamValue){.valueType = JSON_VALUE_TYPE_NULL};
+            return scan_literal(pCursor, "null");
+        default: return scan_number(pCursor, pValueOut);
+    }
+}
+
+// Members mode parses the inside of an object (the text between its braces) as if the
+// object was already entered, so a slice of a big root object can be parsed on its own
+static bool parse_stream(JsonCursor cursor, bool isMembers, const JsonStreamCallbacks* pCallbacks, void* pUser)
+{
+    JsonValueType stack[JSON_STREAM_MAX_DEPTH];
+    size_t depth = 0;
+    size_t baseDepth = 0;
+
+    JsonStreamState state = JSON_STREAM_STATE_VALUE;
+    if (isMembers)
+    {
+        stack[depth++] = JSON_VALUE_TYPE_OBJECT;
+        baseDepth = 1;
+        skip_whitespace(&cursor);
+        state = cursor.p == cursor.end ? JSON_STREAM_STATE_AFTER_VALUE : JSON_STREAM_STATE_KEY;
+    }
+
+    for (;;)
+    {
+        skip_whitespace(&cursor);
+        if (state == JSON_STREAM_STATE_VALUE)
+        {
+            if (cursor_is(&cursor, '{') || cursor_is(&cursor, '['))
+            {
+                JsonValueType valueType = *cursor.p == '{' ? JSON_VALUE_TYPE_OBJECT : JSON_VALUE_TYPE_ARRAY;
+                ERR_RET(depth >= JSON_STREAM_MAX_DEPTH, ERR_PARSING, false);
+                if (pCallbacks->onEnter && !pCallbacks->onEnter(pUser, valueType)) return false;
+                stack[depth++] = valueType;
+                cursor.p++;
+
+                skip_whitespace(&cursor);
+                if (cursor_is(&cursor, valueType == JSON_VALUE_TYPE_OBJECT ? '}' : ']'))
+                {
+                    cursor.p++;
+                    depth--;
+                    if (pCallbacks->onLeave && !pCallbacks->onLeave(pUser, valueType)) return false;
+                    state = JSON_STREAM_STATE_AFTER_VALUE;
+                }
+                else state = valueType == JSON_VALUE_TYPE_OBJECT ? JSON_STREAM_STATE_KEY : JSON_STREAM_STATE_VALUE;
+            }
+            else
+            {
+                JsonStreamValue value;
+                ERR_RET(!scan_scalar(&cursor, &value), ERR_PARSING, false);
+                if (pCallbacks->onValue && !pCallbacks->onValue(pUser, &value)) return false;
+                state = JSON_STREAM_STATE_AFTER_VALUE;
+            }
+        }
+        else if (state == JSON_STREAM_STATE_KEY)
+        {
+            JsonStreamValue key;
+            ERR_RET(!scan_string(&cursor, &key), ERR_PARSING, false);
+            if (pCallbacks->onKey && !pCallbacks->onKey(pUser, &key)) return false;
+
+            skip_whitespace(&cursor);
+            ERR_RET(!cursor_is(&cursor, ':'), ERR_PARSING, false);
+            cursor.p++;
+            state = JSON_STREAM_STATE_VALUE;
+        }
+        else
+        {
+            if (depth == baseDepth)
+            {
+                // Trailing NULL terminators from dataio are allowed
+                while (cursor.p < cursor.end && *cursor.p == '\0') cursor.p++;
+                if (cursor.p == cursor.end) return true;
+                ERR_RET(depth == 0, ERR_PARSING, false);
+            }
+
+            JsonValueType top = stack[depth - 1];
+            if (cursor_is(&cursor, ','))
+            {
+                cursor.p++;
+                state = top == JSON_VALUE_TYPE_OBJECT ? JSON_STREAM_STATE_KEY : JSON_STREAM_STATE_VALUE;
+            }
+            else if (depth > baseDepth && cursor_is(&cursor, top == JSON_VALUE_TYPE_OBJECT ? '}' : ']'))
+            {
+                cursor.p++;
+                depth--;
+                if (pCallbacks->onLeave && !pCallbacks->onLeave(pUser, top)) return false;
+            }
+            else ERR_RET(true, ERR_PARSING, false);
+        }
+    }
+}
+
+bool json_parse_stream(const char* jsonString, size_t length, const JsonStreamCallbacks* pCallbacks, void* pUser)
+{
+    ERR_RET(jsonString == NULL, ERR_INVALID_ARGS, false);
+    ERR_RET(pCallbacks == NULL, ERR_INVALID_ARGS, false);
+
+    return parse_stream((JsonCursor){jsonString, jsonString + length}, false, pCallbacks, pUser);
+}
+
+bool json_parse_stream_members(const char* jsonString, size_t length, const JsonStreamCallbacks* pCallbacks, void* pUser)
+{
+    ERR_RET(jsonString == NULL, ERR_INVALID_ARGS, false);
+    ERR_RET(pCallbacks == NULL, ERR_INVALID_ARGS, false);
+
+    return parse_stream((JsonCursor){jsonString, jsonString + length}, true, pCallbacks, pUser);
+}
+
+size_t json_stream_split(const char* jsonString, size_t length, JsonStreamRange* pRangesOut, size_t count)
+{
+    ERR_RET(jsonString == NULL || pRangesOut == NULL || count == 0, ERR_INVALID_ARGS, 0);
+
+    JsonCursor cursor = {jsonString, jsonString + length};
+    skip_whitespace(&cursor);
+    ERR_RET(!cursor_is(&cursor, '{'), ERR_PARSING, 0);
+    const char* bodyStart = cursor.p + 1;
+
+    const char* bodyEnd = cursor.end;
+    // Trailing whitespace and NULL terminators from dataio
+    while (bodyEnd > bodyStart && (bodyEnd[-1] == '\0' || strchr(" \n\r\t", bodyEnd[-1]) != NULL)) bodyEnd--;
+    ERR_RET(bodyEnd == bodyStart || bodyEnd[-1] != '}', ERR_PARSING, 0);
+    bodyEnd--;
+
+    // Only tracks strings and nesting to find the commas between root members, the
+    // members themselves are checked when they are parsed
+    size_t bodySize = (size_t)(bodyEnd - bodyStart);
+    size_t rangeCount = 0;
+    const char* rangeStart = bodyStart;
+    const char* target = bodyStart + bodySize / count;
+    size_t depth = 0;
+    for (const char* p = bodyStart; p < bodyEnd && rangeCount + 1 < count; p++)
+    {
+        switch (*p)
+        {
+            case '"':
+                for (p++; p < bodyEnd && *p != '"'; p++)
+                {
+                    if (*p == '\\') p++;
+                }
+                break;
+            case '{': case '[': depth++; break;
+            case '}': case ']': ERR_RET(depth == 0, ERR_PARSING, 0); depth--; break;
+            case ',':
+                if (depth != 0 || p < target) break;
+                pRangesOut[rangeCount++] = (JsonStreamRange){(size_t)(rangeStart - jsonString), (size_t)(p - rangeStart)};
+                rangeStart = p + 1;
+                target = bodyStart + bodySize * (rangeCount + 1) / count;
+                break;
+        }
+    }
+    pRangesOut[rangeCount++] = (JsonStreamRange){(size_t)(rangeStart - jsonString), (size_t)(bodyEnd - rangeStart)};
+
+    return rangeCount;
+}
+
+static inline int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_hex4(const char* str, const char* end, uint32_t* pOut)
+{
+    if (end - str < 4) return false;
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; i++)
+    {
+        int digit = hex_digit(str[i]);
+        if (digit < 0) return false;
+        value = value << 4 | (uint32_t)digit;
+    }
+    *pOut = value;
+    return true;
+}
+
+size_t json_stream_unescape(const JsonStreamValue* pValue, char* pOut, size_t outSize)
+{
+    ERR_RET(pOut == NULL || outSize == 0, ERR_INVALID_ARGS, 0);
+
+    const char* p = pValue->str;
+    const char* end = pValue->str + pValue->length;
+    size_t length = 0;
+
+    while (p < end)
+    {
+        char bytes[4];
+        size_t byteCount = 1;
+        bytes[0] = *p++;
+
+        if (bytes[0] == '\\' && p < end)
+        {
+            char c = *p++;
+            switch (c)
+            {
+                case 'b': bytes[0] = '\b'; break;
+                case 'f': bytes[0] = '\f'; break;
+                case 'n': bytes[0] = '\n'; break;
+                case 'r': bytes[0] = '\r'; break;
+                case 't': bytes[0] = '\t'; break;
+                case 'u':
+                {
+                    uint32_t codepoint = 0;
+                    if (!read_hex4(p, end, &codepoint)) { bytes[0] = '?'; break; }
+                    p += 4;
+
+                    uint32_t low = 0;
+                    if (codepoint >= 0xD800 && codepoint < 0xDC00 &&
+                        end - p >= 6 && p[0] == '\\' && p[1] == 'u' && read_hex4(p + 2, end, &low) &&
+                        low >= 0xDC00 && low < 0xE000)
+                    {
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+
+                    if (codepoint < 0x80) bytes[0] = (char)codepoint;
+                    else if (codepoint < 0x800)
+                    {
+                        bytes[0] = (char)(0xC0 | codepoint >> 6);
+                        bytes[1] = (char)(0x80 | (codepoint & 0x3F));
+                        byteCount = 2;
+                    }
+                    else if (codepoint < 0x10000)
+                    {
+                        bytes[0] = (char)(0xE0 | codepoint >> 12);
+                        bytes[1] = (char)(0x80 | (codepoint >> 6 & 0x3F));
+                        bytes[2] = (char)(0x80 | (codepoint & 0x3F));
+                        byteCount = 3;
+                    }
+                    else
+                    {
+                        bytes[0] = (char)(0xF0 | codepoint >> 18);
+                        bytes[1] = (char)(0x80 | (codepoint >> 12 & 0x3F));
+                        bytes[2] = (char)(0x80 | (codepoint >> 6 & 0x3F));
+                        bytes[3] = (char)(0x80 | (codepoint & 0x3F));
+                        byteCount = 4;
+                    }
+                    break;
+                }
+                default: bytes[0] = c; break; // \" \\ \/
+            }
+        }
+
+        if (length + byteCount >= outSize) break;
+        memcpy(pOut + length, bytes, byteCount);
+        length += byteCount;
+    }
+
+    pOut[length] = '\0';
+    return length;
+}
+
+bool json_stream_equals(const JsonStreamValue* pValue, const char* str)
+{
+    if (!pValue->escaped)
+        return strlen(str) == pValue->length && !memcmp(pValue->str, str, pValue->length);
+
+    char decoded[JSON_KEY_SIZE];
+    json_stream_unescape(pValue, decoded, sizeof(decoded));
+    return !strcmp(decoded, str);
+}
@@ -0,0 +1,77 @@
+#ifndef JSONSTREAM_H
+#define JSONSTREAM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <LTK/jsonparser.h>
+
+#ifndef JSON_STREAM_MAX_DEPTH
+#define JSON_STREAM_MAX_DEPTH 64
+#endif
+
+typedef struct
+{
+    JsonValueType valueType;
+    const char* str;    // Points into the source text (strings without quotes, numbers as written)
+    size_t length;
+    bool escaped;       // String contains escape sequences, decode with json_stream_unescape
+    double number;
+    bool boolean;
+} JsonStreamValue;
+
+// Every callback is optional (NULL) and returning false stops the parse
+typedef struct
+{
+    bool (*onKey)(void* pUser, const JsonStreamValue* pKey);
+    bool (*onValue)(void* pUser, const JsonStreamValue* pValue);
+    bool (*onEnter)(void* pUser, JsonValueType valueType);
+    bool (*onLeave)(void* pUser, JsonValueType valueType);
+} JsonStreamCallbacks;
+
+/// @brief Parses a json string without building a JsonValue tree, reporting it through callbacks instead
+//  (onEnter/onLeave for objects and arrays, onKey for object keys, onValue for everything else)
+/// @param[in] jsonString Json string
+/// @param length Length of jsonString in bytes
+/// @param[in] pCallbacks Event callbacks
+/// @param[in] pUser Passed to every callback
+/// @return TRUE if the whole document was parsed, FALSE on a syntax error or a callback stopping it
+bool json_parse_stream(const char* jsonString, size_t length, const JsonStreamCallbacks* pCallbacks, void* pUser);
+
+typedef struct
+{
+    size_t offset;
+    size_t length;
+} JsonStreamRange;
+
+/// @brief Parses the members of an object without its braces ("a": 1, "b": {...}), events are
+//  reported as if the object was already entered (no onEnter/onLeave for it)
+/// @param[in] jsonString Object members, usually a range from json_stream_split
+/// @param length Length of jsonString in bytes
+/// @param[in] pCallbacks Event callbacks
+/// @param[in] pUser Passed to every callback
+/// @return TRUE if every member was parsed, FALSE on a syntax error or a callback stopping it
+bool json_parse_stream_members(const char* jsonString, size_t length, const JsonStreamCallbacks* pCallbacks, void* pUser);
+
+/// @brief Splits the members of a root object into up to count ranges of about equal size, cut
+//  between members so each range can be given to json_parse_stream_members
+/// @param[in] jsonString Json string with an object as root
+/// @param length Length of jsonString in bytes
+/// @param[out] pRangesOut count ranges, offsets into jsonString
+/// @param count Maximum number of ranges
+/// @return Number of ranges written, 0 if the root isn't an object
+size_t json_stream_split(const char* jsonString, size_t length, JsonStreamRange* pRangesOut, size_t count);
+
+/// @brief Decodes the escape sequences of a string value (always NULL terminates, truncates to outSize)
+/// @param[in] pValue String value or key from a callback
+/// @param[out] pOut Output buffer
+/// @param outSize Size of pOut in bytes
+/// @return Decoded length in bytes (without terminator)
+size_t json_stream_unescape(const JsonStreamValue* pValue, char* pOut, size_t outSize);
+
+/// @brief Compares a string value or key with a NULL terminated string
+/// @param[in] pValue String value or key from a callback
+/// @param[in] str NULL terminated string
+/// @return TRUE if equal
+bool json_stream_equals(const JsonStreamValue* pValue, const char* str);
+
+#endif // JSONSTREAM_H
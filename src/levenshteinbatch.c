@@ -0,0 +1,463 @@
+#include "levenshteinbatch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <LTK/error_handling.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LEVENSHTEIN_BATCH_X86
+#include <immintrin.h>
+#endif
+
+#define LEVENSHTEIN_BATCH_ALIGNMENT 64
+
+// Block kernels give up on a block once every lane is sure to end over maxDist, all its
+// distances are maxDist + 1 then. Distances never exceed sizeof(WynnItemName) so a maxDist
+// at or above LEVENSHTEIN_BLOCK_UNBOUNDED turns the check off.
+#define LEVENSHTEIN_BLOCK_UNBOUNDED 128
+// Columns between threshold checks
+#define LEVENSHTEIN_BLOCK_CHECK_MASK 7
+
+_Static_assert(
+    LEVENSHTEIN_BATCH_WIDTH == 8 || LEVENSHTEIN_BATCH_WIDTH == 16 || LEVENSHTEIN_BATCH_WIDTH == 32, 
+    "LEVENSHTEIN_BATCH_WIDTH has to be 8, 16 or 32");
+
+static LevenshteinBlockKernel block_kernel(const char** pNameOut);
+
+LevenshteinBatch levenshtein_batch_create(WynnItemNameTable* pTable, WynnItemList* pItemList)
+{
+    LevenshteinBatch batch = {0};
+    ERR_RET(pTable->count != wynnitem_list_size(pItemList), ERR_INVALID_ARGS, batch);
+    batch.count = pTable->count;
+    batch.blockCount = (batch.count + LEVENSHTEIN_BATCH_WIDTH - 1) / LEVENSHTEIN_BATCH_WIDTH;
+
+    size_t blocksSize = batch.blockCount * sizeof(LevenshteinBlock);
+    size_t itemsSize = batch.blockCount * LEVENSHTEIN_BATCH_WIDTH * sizeof(WynnItem*);
+    batch.pMemory = calloc(1, blocksSize + itemsSize + LEVENSHTEIN_BATCH_ALIGNMENT);
+    ERR_RET(batch.pMemory == NULL, ERR_FAILURE, (LevenshteinBatch){0});
+    uintptr_t aligned = ((uintptr_t)batch.pMemory + LEVENSHTEIN_BATCH_ALIGNMENT - 1) & 
+        ~(uintptr_t)(LEVENSHTEIN_BATCH_ALIGNMENT - 1);
+    batch.pBlocks = (LevenshteinBlock*)aligned;
+    batch.ppItems = (WynnItem**)(aligned + blocksSize);
+    batch.kernel = block_kernel(NULL);
+
+    // Counting sort by length, names are shorter than sizeof(WynnItemName)
+    size_t starts[sizeof(WynnItemName) + 1] = {0};
+    for (size_t row = 0; row < batch.count; row++) starts[pTable->pLengths[row] + 1]++;
+    for (size_t length = 1; length <= sizeof(WynnItemName); length++) starts[length] += starts[length - 1];
+
+    for (size_t row = 0; row < batch.count; row++)
+    {
+        size_t length = pTable->pLengths[row];
+        size_t i = starts[length]++;
+        LevenshteinBlock* pBlock = &batch.pBlocks[i / LEVENSHTEIN_BATCH_WIDTH];
+        size_t lane = i % LEVENSHTEIN_BATCH_WIDTH;
+
+        const char* name = pTable->pNames[row].str;
+        for (size_t j = 0; j < length; j++)
+        {
+            pBlock->bytes[j][lane] = (uint8_t)name[j];
+        }
+        pBlock->lengths[lane] = length;
+        pBlock->classes[lane] = pTable->pClasses[row];
+        pBlock->maxLength = length > pBlock->maxLength ? length : pBlock->maxLength;
+        batch.ppItems[i] = wynnitem_list_get(pItemList, row);
+    }
+
+    return batch;
+}
+
+void levenshtein_batch_destroy(LevenshteinBatch* pBatch)
+{
+    free(pBatch->pMemory);
+    *pBatch = (LevenshteinBatch){0};
+}
+
+static inline void block_abandon(uint32_t maxDist, uint32_t* pDistancesOut)
+{
+    for (size_t lane = 0; lane < LEVENSHTEIN_BATCH_WIDTH; lane++) pDistancesOut[lane] = maxDist + 1;
+}
+
+// Same recurrence as levenshtein_myers, lanes past their name length keep their state
+static void block_scalar(const LevenshteinPattern* pPattern, const LevenshteinBlock* pBlock, uint32_t maxDist, uint32_t* pDistancesOut)
+{
+    for (size_t lane = 0; lane < LEVENSHTEIN_BATCH_WIDTH; lane++)
+    {
+        uint64_t pv = ~0ULL;
+        uint64_t mv = 0;
+        uint32_t score = pPattern->length;
+        for (size_t j = 0; j < pBlock->lengths[lane]; j++)
+        {
+            uint64_t eq = pPattern->peq[pBlock->bytes[j][lane]];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+
+            score += (ph & pPattern->lastBit) != 0;
+            score -= (mh & pPattern->lastBit) != 0;
+
+            // Each remaining column lowers the score by at most one
+            if (score > maxDist + (pBlock->lengths[lane] - j - 1))
+            {
+                score = maxDist + 1;
+                break;
+            }
+
+            ph = ph << 1 | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+        }
+        pDistancesOut[lane] = score;
+    }
+}
+
+#ifdef LEVENSHTEIN_BATCH_X86
+#define SSE2_VECTORS (LEVENSHTEIN_BATCH_WIDTH / 2)
+
+// Two lanes per vector, the pattern masks are picked up with scalar loads
+__attribute__((target("sse2")))
+static void block_sse2(const LevenshteinPattern* pPattern, const LevenshteinBlock* pBlock, uint32_t maxDist, uint32_t* pDistancesOut)
+{
+    const __m128i ones = _mm_set1_epi64x(-1);
+    const __m128i one = _mm_set1_epi64x(1);
+    const __m128i last = _mm_set1_epi64x((int64_t)pPattern->lastBit);
+    const __m128i lastShift = _mm_cvtsi32_si128((int)pPattern->length - 1);
+
+    __m128i pv[SSE2_VECTORS], mv[SSE2_VECTORS], score[SSE2_VECTORS];
+    for (size_t v = 0; v < SSE2_VECTORS; v++)
+    {
+        pv[v] = ones;
+        mv[v] = _mm_setzero_si128();
+        score[v] = _mm_set1_epi64x(pPattern->length);
+    }
+
+    for (uint64_t j = 0; j < pBlock->maxLength; j++)
+    {
+        const uint8_t* pBytes = pBlock->bytes[j];
+        for (size_t v = 0; v < SSE2_VECTORS; v++)
+        {
+            size_t lane = v * 2;
+            __m128i active = _mm_set_epi64x(
+                -(int64_t)(j < pBlock->lengths[lane + 1]), -(int64_t)(j < pBlock->lengths[lane]));
+            __m128i eq = _mm_set_epi64x(
+                (int64_t)pPattern->peq[pBytes[lane + 1]], (int64_t)pPattern->peq[pBytes[lane]]);
+
+            __m128i xv = _mm_or_si128(eq, mv[v]);
+            __m128i sum = _mm_add_epi64(_mm_and_si128(eq, pv[v]), pv[v]);
+            __m128i xh = _mm_or_si128(_mm_xor_si128(sum, pv[v]), eq);
+            __m128i ph = _mm_or_si128(mv[v], _mm_andnot_si128(_mm_or_si128(xh, pv[v]), ones));
+            __m128i mh = _mm_and_si128(pv[v], xh);
+
+            __m128i up = _mm_srl_epi64(_mm_and_si128(ph, last), lastShift);
+            __m128i down = _mm_srl_epi64(_mm_and_si128(mh, last), lastShift);
+            __m128i newScore = _mm_sub_epi64(_mm_add_epi64(score[v], up), down);
+
+            ph = _mm_or_si128(_mm_slli_epi64(ph, 1), one);
+            mh = _mm_slli_epi64(mh, 1);
+            __m128i newPv = _mm_or_si128(mh, _mm_andnot_si128(_mm_or_si128(xv, ph), ones));
+            __m128i newMv = _mm_and_si128(ph, xv);
+
+            pv[v] = _mm_or_si128(_mm_and_si128(active, newPv), _mm_andnot_si128(active, pv[v]));
+            mv[v] = _mm_or_si128(_mm_and_si128(active, newMv), _mm_andnot_si128(active, mv[v]));
+            score[v] = _mm_or_si128(_mm_and_si128(active, newScore), _mm_andnot_si128(active, score[v]));
+        }
+
+        if ((j & LEVENSHTEIN_BLOCK_CHECK_MASK) != LEVENSHTEIN_BLOCK_CHECK_MASK || maxDist >= LEVENSHTEIN_BLOCK_UNBOUNDED) 
+            continue;
+
+        // score + consumed columns > maxDist + length, everything fits the low 32 bits of a lane
+        __m128i consumed = _mm_set1_epi64x((int64_t)j + 1);
+        int over = 0xFFFF;
+        for (size_t v = 0; v < SSE2_VECTORS; v++)
+        {
+            __m128i lengths = _mm_loadu_si128((const __m128i*)&pBlock->lengths[v * 2]);
+            __m128i isDone = _mm_cmpgt_epi32(consumed, lengths);
+            __m128i lhs = _mm_add_epi64(score[v], 
+                _mm_or_si128(_mm_and_si128(isDone, lengths), _mm_andnot_si128(isDone, consumed)));
+            __m128i rhs = _mm_add_epi64(lengths, _mm_set1_epi64x(maxDist));
+            over &= _mm_movemask_epi8(_mm_cmpgt_epi32(lhs, rhs));
+        }
+        if ((over & 0x0F0F) == 0x0F0F)
+        {
+            block_abandon(maxDist, pDistancesOut);
+            return;
+        }
+    }
+
+    for (size_t v = 0; v < SSE2_VECTORS; v++)
+    {
+        uint64_t scores[2];
+        _mm_storeu_si128((__m128i*)scores, score[v]);
+        pDistancesOut[v * 2] = (uint32_t)scores[0];
+        pDistancesOut[v * 2 + 1] = (uint32_t)scores[1];
+    }
+}
+
+#define AVX2_VECTORS (LEVENSHTEIN_BATCH_WIDTH / 4)
+
+// Four lanes per vector, the pattern masks are gathered with the transposed name bytes as indices
+__attribute__((target("avx2")))
+static void block_avx2(const LevenshteinPattern* pPattern, const LevenshteinBlock* pBlock, uint32_t maxDist, uint32_t* pDistancesOut)
+{
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i last = _mm256_set1_epi64x((int64_t)pPattern->lastBit);
+    const __m128i lastShift = _mm_cvtsi32_si128((int)pPattern->length - 1);
+    const long long* pPeq = (const long long*)pPattern->peq;
+
+    __m256i pv[AVX2_VECTORS], mv[AVX2_VECTORS], score[AVX2_VECTORS], lengths[AVX2_VECTORS];
+    for (size_t v = 0; v < AVX2_VECTORS; v++)
+    {
+        pv[v] = ones;
+        mv[v] = _mm256_setzero_si256();
+        score[v] = _mm256_set1_epi64x(pPattern->length);
+        lengths[v] = _mm256_loadu_si256((const __m256i*)&pBlock->lengths[v * 4]);
+    }
+
+    for (uint64_t j = 0; j < pBlock->maxLength; j++)
+    {
+        __m256i position = _mm256_set1_epi64x((int64_t)j);
+        int32_t bytes[AVX2_VECTORS];
+        memcpy(bytes, pBlock->bytes[j], sizeof(bytes));
+
+        for (size_t v = 0; v < AVX2_VECTORS; v++)
+        {
+            __m256i active = _mm256_cmpgt_epi64(lengths[v], position);
+            __m128i indices = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes[v]));
+            __m256i eq = _mm256_i32gather_epi64(pPeq, indices, 8);
+
+            __m256i xv = _mm256_or_si256(eq, mv[v]);
+            __m256i sum = _mm256_add_epi64(_mm256_and_si256(eq, pv[v]), pv[v]);
+            __m256i xh = _mm256_or_si256(_mm256_xor_si256(sum, pv[v]), eq);
+            __m256i ph = _mm256_or_si256(mv[v], _mm256_andnot_si256(_mm256_or_si256(xh, pv[v]), ones));
+            __m256i mh = _mm256_and_si256(pv[v], xh);
+
+            __m256i up = _mm256_srl_epi64(_mm256_and_si256(ph, last), lastShift);
+            __m256i down = _mm256_srl_epi64(_mm256_and_si256(mh, last), lastShift);
+            __m256i newScore = _mm256_sub_epi64(_mm256_add_epi64(score[v], up), down);
+
+            ph = _mm256_or_si256(_mm256_slli_epi64(ph, 1), one);
+            mh = _mm256_slli_epi64(mh, 1);
+            __m256i newPv = _mm256_or_si256(mh, _mm256_andnot_si256(_mm256_or_si256(xv, ph), ones));
+            __m256i newMv = _mm256_and_si256(ph, xv);
+
+            pv[v] = _mm256_blendv_epi8(pv[v], newPv, active);
+            mv[v] = _mm256_blendv_epi8(mv[v], newMv, active);
+            score[v] = _mm256_blendv_epi8(score[v], newScore, active);
+        }
+
+        if ((j & LEVENSHTEIN_BLOCK_CHECK_MASK) != LEVENSHTEIN_BLOCK_CHECK_MASK || maxDist >= LEVENSHTEIN_BLOCK_UNBOUNDED) 
+            continue;
+
+        // score + consumed columns > maxDist + length, lanes past their length consumed all of it
+        __m256i consumed = _mm256_set1_epi64x((int64_t)j + 1);
+        int over = 0xF;
+        for (size_t v = 0; v < AVX2_VECTORS; v++)
+        {
+            __m256i isDone = _mm256_cmpgt_epi64(consumed, lengths[v]);
+            __m256i lhs = _mm256_add_epi64(score[v], _mm256_blendv_epi8(consumed, lengths[v], isDone));
+            __m256i rhs = _mm256_add_epi64(lengths[v], _mm256_set1_epi64x(maxDist));
+            over &= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(lhs, rhs)));
+        }
+        if (over == 0xF)
+        {
+            block_abandon(maxDist, pDistancesOut);
+            return;
+        }
+    }
+
+    for (size_t v = 0; v < AVX2_VECTORS; v++)
+    {
+        uint64_t scores[4];
+        _mm256_storeu_si256((__m256i*)scores, score[v]);
+        for (size_t i = 0; i < 4; i++) pDistancesOut[v * 4 + i] = (uint32_t)scores[i];
+    }
+}
+#endif
+
+// No state is kept, batches store the kernel so scans on worker threads only read it
+static LevenshteinBlockKernel block_kernel(const char** pNameOut)
+{
+    const char* name = "scalar";
+    LevenshteinBlockKernel kernel = block_scalar;
+#ifdef LEVENSHTEIN_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        name = "avx2";
+        kernel = block_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        name = "sse2";
+        kernel = block_sse2;
+    }
+#endif
+
+    if (pNameOut != NULL) *pNameOut = name;
+    return kernel;
+}
+
+const char* levenshtein_batch_kernel_name()
+{
+    const char* name = NULL;
+    block_kernel(&name);
+    return name;
+}
+
+void levenshtein_batch_scan(const LevenshteinPattern* pPattern, const LevenshteinBatch* pBatch, uint32_t* pDistancesOut)
+{
+    if (pPattern->length == 0)
+    {
+        for (size_t i = 0; i < pBatch->blockCount * LEVENSHTEIN_BATCH_WIDTH; i++)
+            pDistancesOut[i] = pBatch->pBlocks[i / LEVENSHTEIN_BATCH_WIDTH].lengths[i % LEVENSHTEIN_BATCH_WIDTH];
+        return;
+    }
+
+    for (size_t block = 0; block < pBatch->blockCount; block++)
+    {
+        pBatch->kernel(pPattern, &pBatch->pBlocks[block], LEVENSHTEIN_BLOCK_UNBOUNDED, pDistancesOut + block * LEVENSHTEIN_BATCH_WIDTH);
+    }
+}
+
+// Lower bound on the distance from a query of this length to any name in the block
+static inline uint64_t block_length_gap(const LevenshteinBlock* pBlock, uint64_t length)
+{
+    // Lane 0 is always a name, only the last block has padding lanes and they are at its end
+    uint64_t minLength = pBlock->lengths[0];
+    if (length > pBlock->maxLength) return length - pBlock->maxLength;
+    if (length < minLength) return minLength - length;
+    return 0;
+}
+
+// Smallest lower bound of any lane from its length and character classes, padding lanes included
+static inline uint32_t block_bound(const LevenshteinPattern* pPattern, const LevenshteinBlock* pBlock)
+{
+    uint32_t bound = UINT32_MAX;
+    for (size_t lane = 0; lane < LEVENSHTEIN_BATCH_WIDTH; lane++)
+    {
+        uint64_t length = pBlock->lengths[lane];
+        uint32_t laneBound = (uint32_t)(length > pPattern->length ? length - pPattern->length : pPattern->length - length);
+        uint32_t classBound = wynnitem_name_class_bound(pPattern->classes, pBlock->classes[lane]);
+        laneBound = classBound > laneBound ? classBound : laneBound;
+        bound = laneBound < bound ? laneBound : bound;
+    }
+    return bound;
+}
+
+static void block_top(
+    const LevenshteinPattern* pPattern, 
+    const LevenshteinBatch* pBatch, 
+    size_t block, 
+    LevenshteinTop* pTop)
+{
+    const LevenshteinBlock* pBlock = &pBatch->pBlocks[block];
+    uint32_t distances[LEVENSHTEIN_BATCH_WIDTH];
+    if (pPattern->length == 0)
+    {
+        for (size_t lane = 0; lane < LEVENSHTEIN_BATCH_WIDTH; lane++) distances[lane] = pBlock->lengths[lane];
+    }
+    else
+    {
+        // Only a distance under the worst kept one can make it in
+        uint32_t maxDist = levenshtein_top_is_full(pTop) ? 
+            levenshtein_top_worst(pTop).distance - 1 : LEVENSHTEIN_BLOCK_UNBOUNDED;
+        if (maxDist < LEVENSHTEIN_BLOCK_UNBOUNDED && block_bound(pPattern, pBlock) > maxDist) return;
+        pBatch->kernel(pPattern, pBlock, maxDist, distances);
+    }
+
+    WynnItem** ppItems = pBatch->ppItems + block * LEVENSHTEIN_BATCH_WIDTH;
+    for (size_t lane = 0; lane < LEVENSHTEIN_BATCH_WIDTH; lane++)
+    {
+        if (ppItems[lane] == NULL) continue;
+        levenshtein_top_push(pTop, (struct levenshtein_item){distances[lane], ppItems[lane]});
+    }
+}
+
+// Walks the blocks [first, end) outward from the query length, blocks are in name length order
+static void batch_top_range(
+    const LevenshteinPattern* pPattern, 
+    const LevenshteinBatch* pBatch, 
+    size_t first, 
+    size_t end, 
+    LevenshteinTop* pTop)
+{
+    size_t low = first, high = end;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (pBatch->pBlocks[middle].maxLength < pPattern->length) low = middle + 1;
+        else high = middle;
+    }
+    size_t up = low;            // Next block to the longer side
+    size_t down = low;          // One past the next block to the shorter side
+
+    for (;;)
+    {
+        uint64_t upGap = up < end ? block_length_gap(&pBatch->pBlocks[up], pPattern->length) : UINT64_MAX;
+        uint64_t downGap = down > first ? block_length_gap(&pBatch->pBlocks[down - 1], pPattern->length) : UINT64_MAX;
+        uint64_t gap = upGap < downGap ? upGap : downGap;
+        if (gap == UINT64_MAX) break;
+
+        // Gaps only grow from here on, nothing further out can beat the worst kept name
+        if (levenshtein_top_is_full(pTop) && gap >= levenshtein_top_worst(pTop).distance) break;
+
+        if (upGap <= downGap) block_top(pPattern, pBatch, up++, pTop);
+        else block_top(pPattern, pBatch, --down, pTop);
+    }
+}
+
+void levenshtein_batch_top(const LevenshteinPattern* pPattern, const LevenshteinBatch* pBatch, LevenshteinTop* pTop)
+{
+    batch_top_range(pPattern, pBatch, 0, pBatch->blockCount, pTop);
+}
+
+struct batch_shard_task
+{
+    const LevenshteinPattern* pPattern;
+    const LevenshteinBatch* pBatch;
+    size_t shardCount;
+    LevenshteinTop tops[WORKER_POOL_MAX_THREADS];
+};
+
+static void batch_shard_run(void* pArgs, size_t shard)
+{
+    struct batch_shard_task* pTask = pArgs;
+    size_t blockCount = pTask->pBatch->blockCount;
+    size_t first = blockCount * shard / pTask->shardCount;
+    size_t end = blockCount * (shard + 1) / pTask->shardCount;
+
+    pTask->tops[shard] = levenshtein_top_create();
+    batch_top_range(pTask->pPattern, pTask->pBatch, first, end, &pTask->tops[shard]);
+}
+
+void levenshtein_batch_top_parallel(
+    const LevenshteinPattern* pPattern, 
+    const LevenshteinBatch* pBatch, 
+    WorkerPool* pPool, 
+    LevenshteinTop* pTop)
+{
+    size_t shardCount = pBatch->blockCount / LEVENSHTEIN_BATCH_SHARD_BLOCKS;
+    shardCount = shardCount < worker_pool_size(pPool) ? shardCount : worker_pool_size(pPool);
+    if (shardCount <= 1)
+    {
+        levenshtein_batch_top(pPattern, pBatch, pTop);
+        return;
+    }
+
+    struct batch_shard_task task = {.pPattern = pPattern, .pBatch = pBatch, .shardCount = shardCount};
+    worker_pool_run(pPool, batch_shard_run, &task, shardCount);
+
+    // Shard order and best first within a shard, ties keep the first one pushed so the result
+    // only depends on the shard count
+    for (size_t shard = 0; shard < shardCount; shard++)
+    {
+        struct levenshtein_item items[LEVENSHTEIN_TOP_COUNT];
+        levenshtein_top_to_array(&task.tops[shard], items);
+        for (size_t i = 0; i < levenshtein_top_size(&task.tops[shard]); i++)
+        {
+            if (!levenshtein_top_push(pTop, items[i])) break;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef LEVENSHTEINBATCH_H
+#define LEVENSHTEINBATCH_H
+
+#include "wynnitems.h"
+#include "itemsearch.h"
+#include "workerpool.h"
+#include "nameindex.h"
+
+// Candidates scored together, one 64 bit lane each (8, 16 or 32). Wider blocks keep more
+// independent lanes in flight per name byte but run as long as their longest name and are
+// skipped less often by the top list bounds.
+#ifndef LEVENSHTEIN_BATCH_WIDTH
+#define LEVENSHTEIN_BATCH_WIDTH 8
+#endif
+// Smallest run of blocks worth a worker in levenshtein_batch_top_parallel
+#ifndef LEVENSHTEIN_BATCH_SHARD_BLOCKS
+#define LEVENSHTEIN_BATCH_SHARD_BLOCKS 64
+#endif
+
+// Names of LEVENSHTEIN_BATCH_WIDTH candidates transposed so byte j of every lane is one load
+typedef struct
+{
+    uint8_t bytes[sizeof(WynnItemName)][LEVENSHTEIN_BATCH_WIDTH];
+    uint64_t lengths[LEVENSHTEIN_BATCH_WIDTH];  // 0 for padding lanes
+    uint64_t classes[LEVENSHTEIN_BATCH_WIDTH];  // wynnitem_name_classes, 0 for padding lanes
+    uint64_t maxLength;
+} LevenshteinBlock;
+
+typedef void (*LevenshteinBlockKernel)(
+    const LevenshteinPattern* pPattern, 
+    const LevenshteinBlock* pBlock, 
+    uint32_t maxDist, 
+    uint32_t* pDistancesOut);
+
+struct LevenshteinBatch
+{
+    LevenshteinBlockKernel kernel;  // Picked for this cpu when the batch is created
+    LevenshteinBlock* pBlocks;
+    WynnItem** ppItems;     // Lane order, blockCount * LEVENSHTEIN_BATCH_WIDTH (NULL for padding lanes)
+    size_t count;
+    size_t blockCount;
+    void* pMemory;
+};
+
+/// @brief Packs the normalized item names into blocks, candidates are ordered by name length so each
+//  block only runs as long as its own names. Queries have to be normalized the same way.
+/// @param[in] pTable Normalized names of pItemList
+/// @param[in] pItemList Items to pack
+/// @return Batch, destroy with levenshtein_batch_destroy
+LevenshteinBatch levenshtein_batch_create(WynnItemNameTable* pTable, WynnItemList* pItemList);
+void levenshtein_batch_destroy(LevenshteinBatch* pBatch);
+
+/// @brief Edit distance from a query to every candidate of the batch (AVX2, SSE2 or scalar, picked by levenshtein_batch_create)
+/// @param[in] pPattern Query from levenshtein_pattern
+/// @param[in] pBatch Candidates
+/// @param[out] pDistancesOut blockCount * LEVENSHTEIN_BATCH_WIDTH distances in lane order
+void levenshtein_batch_scan(const LevenshteinPattern* pPattern, const LevenshteinBatch* pBatch, uint32_t* pDistancesOut);
+
+/// @brief Adds the closest candidates of the batch to a top list, blocks are visited outward from
+//  the query length and the scan stops once the length difference alone rules out the rest.
+//  Blocks whose length and character class bounds can't beat the top list are not scored.
+/// @param[in] pPattern Query from levenshtein_pattern
+/// @param[in] pBatch Candidates
+/// @param[in,out] pTop Top list, may already hold items
+void levenshtein_batch_top(const LevenshteinPattern* pPattern, const LevenshteinBatch* pBatch, LevenshteinTop* pTop);
+
+/// @brief levenshtein_batch_top over contiguous shards of the batch on a worker pool, each shard keeps
+//  its own top list and they are merged in shard order
+/// @param[in] pPattern Query from levenshtein_pattern
+/// @param[in] pBatch Candidates
+/// @param[in] pPool Workers
+/// @param[in,out] pTop Top list, may already hold items
+void levenshtein_batch_top_parallel(
+    const LevenshteinPattern* pPattern, 
+    const LevenshteinBatch* pBatch, 
+    WorkerPool* pPool, 
+    LevenshteinTop* pTop);
+
+/// @brief Name of the kernel levenshtein_batch_scan uses on this cpu
+const char* levenshtein_batch_kernel_name();
+
+#endif // LEVENSHTEINBATCH_H
@@ -0,0 +1,173 @@
+#include "levenshteintree.h"
+#include <stdlib.h>
+#include <string.h>
+#include <LTK/error_handling.h>
+
+struct levenshtein_tree_visit
+{
+    uint32_t node;
+    uint32_t bound;     // Lower bound on the distance from the query to the node
+};
+
+static int levenshtein_tree_cmp(
+    const struct levenshtein_item* pItemA,
+    const struct levenshtein_item* pItemB)
+{
+    return pItemA->distance < pItemB->distance ? -1 : 1;
+}
+
+// Worst match on top, so the k-th best distance is always a peek away
+static int levenshtein_tree_worst_cmp(
+    const struct levenshtein_item* pItemA,
+    const struct levenshtein_item* pItemB)
+{
+    return pItemA->distance > pItemB->distance ? -1 : 1;
+}
+
+static inline uint32_t distance_gap(uint32_t a, uint32_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+LevenshteinTree levenshtein_tree_create(WynnItemNameTable* pTable, WynnItemList* pItemList)
+{
+    LevenshteinTree tree = {0};
+    ERR_RET(pTable->count != wynnitem_list_size(pItemList), ERR_INVALID_ARGS, tree);
+    tree.count = pTable->count;
+    if (tree.count == 0) return tree;
+
+    tree.pNodes = malloc(tree.count * sizeof(LevenshteinTreeNode));
+    ERR_RET(tree.pNodes == NULL, ERR_FAILURE, (LevenshteinTree){0});
+
+    for (size_t i = 0; i < tree.count; i++)
+    {
+        WynnItem* pItem = wynnitem_list_get(pItemList, i);
+        LevenshteinTreeNode* pNode = &tree.pNodes[i];
+        *pNode = (LevenshteinTreeNode){pItem, pTable->pNames[i].str, LEVENSHTEIN_TREE_NONE, LEVENSHTEIN_TREE_NONE, 0, pTable->pLengths[i]};
+        if (i == 0) continue;
+
+        // Walks down the child with the same distance until there is none, then adds one
+        LevenshteinPattern pattern = levenshtein_pattern(pNode->name);
+        uint32_t parent = 0;
+        for (;;)
+        {
+            uint32_t distance = levenshtein_myers_sized(&pattern, tree.pNodes[parent].name, tree.pNodes[parent].length);
+            uint32_t* pLink = &tree.pNodes[parent].firstChild;
+            while (*pLink != LEVENSHTEIN_TREE_NONE && tree.pNodes[*pLink].edge < distance)
+            {
+                pLink = &tree.pNodes[*pLink].nextSibling;
+            }
+
+            if (*pLink != LEVENSHTEIN_TREE_NONE && tree.pNodes[*pLink].edge == distance)
+            {
+                parent = *pLink;
+                continue;
+            }
+
+            pNode->edge = distance;
+            pNode->nextSibling = *pLink;
+            *pLink = (uint32_t)i;
+            break;
+        }
+    }
+
+    return tree;
+}
+
+void levenshtein_tree_destroy(LevenshteinTree* pTree)
+{
+    free(pTree->pNodes);
+    *pTree = (LevenshteinTree){0};
+}
+
+LevenshteinHeap levenshtein_tree_find_within(LevenshteinTree* pTree, const char* query, uint32_t maxDist)
+{
+    LevenshteinHeap heap = levenshtein_heap_create(levenshtein_tree_cmp);
+    if (pTree->count == 0) return heap;
+
+    // Every node is pushed at most once
+    uint32_t* pStack = malloc(pTree->count * sizeof(uint32_t));
+    ERR_RET(pStack == NULL, ERR_FAILURE, heap);
+    size_t stackSize = 0;
+    pStack[stackSize++] = 0;
+
+    LevenshteinPattern pattern = levenshtein_pattern(query);
+    while (stackSize > 0)
+    {
+        LevenshteinTreeNode* pNode = &pTree->pNodes[pStack[--stackSize]];
+        uint32_t distance = levenshtein_myers_sized(&pattern, pNode->name, pNode->length);
+        if (distance <= maxDist)
+            levenshtein_heap_push(&heap, (struct levenshtein_item){distance, pNode->pItem});
+
+        uint32_t low = distance > maxDist ? distance - maxDist : 0;
+        uint32_t high = distance + maxDist;
+        for (uint32_t child = pNode->firstChild; child != LEVENSHTEIN_TREE_NONE; child = pTree->pNodes[child].nextSibling)
+        {
+            uint32_t edge = pTree->pNodes[child].edge;
+            if (edge > high) break;
+            if (edge >= low) pStack[stackSize++] = child;
+        }
+    }
+
+    free(pStack);
+    return heap;
+}
+
+LevenshteinHeap levenshtein_tree_k_nearest(LevenshteinTree* pTree, const char* query, size_t k, size_t maxVisits)
+{
+    LevenshteinHeap heap = levenshtein_heap_create(levenshtein_tree_cmp);
+    if (pTree->count == 0 || k == 0) return heap;
+
+    struct levenshtein_tree_visit* pStack = malloc(pTree->count * sizeof(struct levenshtein_tree_visit));
+    ERR_RET(pStack == NULL, ERR_FAILURE, heap);
+    size_t stackSize = 0;
+    pStack[stackSize++] = (struct levenshtein_tree_visit){0, 0};
+
+    LevenshteinHeap best = levenshtein_heap_create(levenshtein_tree_worst_cmp);
+    uint32_t radius = UINT32_MAX;   // k-th best distance once k items are found
+
+    LevenshteinPattern pattern = levenshtein_pattern(query);
+    size_t visitCount = 0;
+    while (stackSize > 0)
+    {
+        // The radius may have shrunk since this node was pushed
+        struct levenshtein_tree_visit visit = pStack[--stackSize];
+        if (visit.bound >= radius) continue;
+        if (maxVisits != 0 && ++visitCount > maxVisits)
+        {
+            levenshtein_heap_destroy(&best);
+            free(pStack);
+            return heap;
+        }
+
+        LevenshteinTreeNode* pNode = &pTree->pNodes[visit.node];
+        uint32_t distance = levenshtein_myers_sized(&pattern, pNode->name, pNode->length);
+        if (levenshtein_heap_size(&best) < k)
+            levenshtein_heap_push(&best, (struct levenshtein_item){distance, pNode->pItem});
+        else if (distance < radius)
+        {
+            levenshtein_heap_pop(&best);
+            levenshtein_heap_push(&best, (struct levenshtein_item){distance, pNode->pItem});
+        }
+        if (levenshtein_heap_size(&best) == k)
+            radius = levenshtein_heap_peek(&best).distance;
+
+        // Children only hold something closer than the radius if their edge is within it of distance
+        for (uint32_t child = pNode->firstChild; child != LEVENSHTEIN_TREE_NONE; child = pTree->pNodes[child].nextSibling)
+        {
+            uint32_t edge = pTree->pNodes[child].edge;
+            uint32_t bound = distance_gap(distance, edge);
+            if (edge > distance && bound >= radius) break;
+            if (bound < radius) pStack[stackSize++] = (struct levenshtein_tree_visit){child, bound};
+        }
+    }
+
+    while (levenshtein_heap_size(&best) > 0)
+    {
+        levenshtein_heap_push(&heap, levenshtein_heap_pop(&best));
+    }
+    levenshtein_heap_destroy(&best);
+    free(pStack);
+
+    return heap;
+}
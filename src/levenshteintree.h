@@ -0,0 +1,53 @@
+#ifndef LEVENSHTEINTREE_H
+#define LEVENSHTEINTREE_H
+
+#include "wynnitems.h"
+#include "itemsearch.h"
+#include "nameindex.h"
+
+// BK-tree over item names, a child hangs off its parent by their edit distance so by the
+// triangle inequality a query at distance d from a node only has to enter children with an
+// edge in [d - radius, d + radius]
+typedef struct
+{
+    WynnItem* pItem;
+    const char* name;       // Normalized
+    uint32_t firstChild;    // LEVENSHTEIN_TREE_NONE if it is a leaf
+    uint32_t nextSibling;   // Siblings are sorted by edge
+    uint32_t edge;          // Distance to the parent
+    uint32_t length;        // Bytes of name
+} LevenshteinTreeNode;
+
+#define LEVENSHTEIN_TREE_NONE UINT32_MAX
+
+typedef struct
+{
+    LevenshteinTreeNode* pNodes;    // Node 0 is the root
+    size_t count;
+} LevenshteinTree;
+
+/// @brief Inserts every normalized item name into a new tree, queries have to be normalized the same way
+/// @param[in] pTable Normalized names of pItemList, have to stay valid for the life of the tree
+/// @param[in] pItemList Items
+/// @return Tree, destroy with levenshtein_tree_destroy
+LevenshteinTree levenshtein_tree_create(WynnItemNameTable* pTable, WynnItemList* pItemList);
+void levenshtein_tree_destroy(LevenshteinTree* pTree);
+
+/// @brief Every item within maxDist edits of a query
+/// @param[in] pTree Tree
+/// @param[in] query NULL terminated query
+/// @param maxDist Largest distance returned
+/// @return Matches, closest first
+LevenshteinHeap levenshtein_tree_find_within(LevenshteinTree* pTree, const char* query, uint32_t maxDist);
+
+/// @brief The k items closest to a query, the search radius shrinks to the k-th best distance
+//  found so far
+/// @param[in] pTree Tree
+/// @param[in] query NULL terminated query
+/// @param k Items returned (fewer if the tree is smaller)
+/// @param maxVisits Nodes the search may score before it gives up, 0 for no limit. Short or garbage
+//  queries prune next to nothing and are better off with a full scan.
+/// @return Matches, closest first. Empty if maxVisits ran out.
+LevenshteinHeap levenshtein_tree_k_nearest(LevenshteinTree* pTree, const char* query, size_t k, size_t maxVisits);
+
+#endif // LEVENSHTEINTREE_H
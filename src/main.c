@@ -7,25 +7,86 @@
 #include "wynnitems.h"
 #include "itemloader.h"
 #include "itemsearch.h"
+#include "featurescan.h"
+#include "nametrie.h"
 
 #define DB_URL "https://api.wynncraft.com/v3/item/database?fullResult"
 #define DB_BIN_PATH "data/wynnitems.bin"
+#define DB_GRAPHS_PATH "data/wynnitems.graphs"
+#define DB_NEIGHBOURS_PATH "data/wynnitems.topk"
 
 int main(int argc, char* argv[])
 {
+    // Runs on generated rows, before anything is loaded
+    if (argc > 1 && !strcmp(argv[1], "--test-scan"))
+        return feature_scan_test() ? 0 : 1;
 
-    WynnItemList* pItemList = wynnitems_load(DB_BIN_PATH, DB_URL);
+    // A mapped cache can't be replaced on Windows, so a refresh loads a copy it can save over
+    bool isRefresh = argc > 1 && !strcmp(argv[1], "--refresh");
+    WynnItemList* pItemList = wynnitems_load(DB_BIN_PATH, DB_URL, isRefresh ? WYNNITEM_LOAD_COPY : WYNNITEM_LOAD_MAPPED);
     wynnitems_init(pItemList);
 
+    wynnitems_graphs_init(DB_GRAPHS_PATH);
+    wynnitems_neighbours_init(DB_NEIGHBOURS_PATH);
+
+    if (argc > 1 && !strcmp(argv[1], "--bench-cache"))
+    {
+        bool isMatching = wynnitems_cache_benchmark(pItemList, DB_BIN_PATH".bench", 20);
+        wynnitems_cleanup();
+        wynnitems_unload();
+        return isMatching ? 0 : 1;
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--bench-features"))
+    {
+        bool isMatching = wynnitems_feature_benchmark(20);
+        wynnitems_cleanup();
+        wynnitems_unload();
+        return isMatching ? 0 : 1;
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--bench-graph"))
+    {
+        bool isBuilt = wynnitems_graph_benchmark(20);
+        wynnitems_cleanup();
+        wynnitems_unload();
+        return isBuilt ? 0 : 1;
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--bench-autocomplete"))
+    {
+        bool isMatching = name_trie_benchmark(pItemList, NAME_TRIE_SEARCH_MAX_DIST);
+        wynnitems_cleanup();
+        wynnitems_unload();
+        return isMatching ? 0 : 1;
+    }
+
+    if (isRefresh)
+    {
+        WynnItemDiff diff = {0};
+        if (wynnitems_refresh(DB_BIN_PATH, DB_URL, &diff) != NULL)
+        {
+            bool isChanged = wynnitem_list_size(&diff.removed) > 0 || wynnitem_list_size(&diff.added) > 0;
+            wynnitems_update(&diff.removed, &diff.added);
+            wynnitem_diff_destroy(&diff);
+            // The refresh only wrote the item cache, the update rebuilt the graphs and neighbours
+            if (isChanged)
+            {
+                wynnitems_graphs_save(DB_GRAPHS_PATH);
+                wynnitems_neighbours_save(DB_NEIGHBOURS_PATH);
+            }
+        }
+    }
+
     itemsearch_start(pItemList);
 
-    // iteminterface_run(NULL);
+    // iteminterface_run(pItemList);
 
     // WynnBuild bestBuild = wynnitems_calculate_build(100000);
 
     // for (size_t i = 0; i < 9; ++i)
     // {
-    //     printf("%s\n", bestBuild.pItems[i]->pName->str);
+    //     printf("%s\n", wynnitem_name(bestBuild.pItems[i])->str);
     // }
     // printf("\n");
 
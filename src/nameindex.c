@@ -0,0 +1,171 @@
+#include "nameindex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <LTK/error_handling.h>
+
+// ################################################################################
+// Exact name lookup
+//
+//
+// ################################################################################
+
+// Plain letter of U+00C0 - U+00FF (0xC3 0x80 - 0xC3 0xBF in UTF-8), 0 where there is none
+static const char gLatinFold[64] = 
+    "aaaaaaaceeeeiiii" "dnooooo\0ouuuuy\0\0"
+    "aaaaaaaceeeeiiii" "dnooooo\0ouuuuy\0y";
+
+static inline bool name_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+size_t wynnitem_name_normalize(const char* name, WynnItemName* pOut)
+{
+    size_t start = 0;
+    size_t end = strnlen(name, sizeof(WynnItemName) - 1);
+    while (start < end && name_is_space(name[start])) start++;
+    while (end > start && name_is_space(name[end - 1])) end--;
+
+    memset(pOut->str, 0, sizeof(WynnItemName));
+    size_t length = 0;
+    for (size_t i = start; i < end; i++)
+    {
+        char c = name[i];
+        uint8_t next = i + 1 < end ? (uint8_t)name[i + 1] : 0;
+        if ((uint8_t)c == 0xC3 && next >= 0x80 && next <= 0xBF && gLatinFold[next - 0x80] != 0)
+        {
+            c = gLatinFold[next - 0x80];
+            i++;
+        }
+        pOut->str[length++] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+    return length;
+}
+
+// FNV-1a, never 0 so 0 can mark empty slots
+static inline uint64_t name_hash(const char* str, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)str[i]) * 1099511628211ULL;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+static bool name_hash_equals(WynnItem* pItem, const WynnItemName* pNormalized)
+{
+    WynnItemName normalized;
+    wynnitem_name_normalize(wynnitem_name(pItem)->str, &normalized);
+    return memcmp(normalized.str, pNormalized->str, sizeof(WynnItemName)) == 0;
+}
+
+// Slot holding the name, or the empty slot it would go into
+static WynnItemNameSlot* name_hash_probe(WynnItemNameHash* pHash, const WynnItemName* pNormalized, uint64_t hash)
+{
+    for (uint32_t slot = (uint32_t)hash & pHash->slotMask;; slot = (slot + 1) & pHash->slotMask)
+    {
+        WynnItemNameSlot* pSlot = &pHash->pSlots[slot];
+        if (pSlot->hash == 0) return pSlot;
+        if (pSlot->hash == hash && name_hash_equals(pSlot->pItem, pNormalized)) return pSlot;
+    }
+}
+
+WynnItemNameHash wynnitem_name_hash_create(WynnItemList* pItemList)
+{
+    WynnItemNameHash nameHash = {0};
+    size_t itemCount = wynnitem_list_size(pItemList);
+
+    // At most half full
+    size_t slotCount = 16;
+    while (slotCount < itemCount * 2) slotCount <<= 1;
+    nameHash.pSlots = calloc(slotCount, sizeof(WynnItemNameSlot));
+    ERR_RET(nameHash.pSlots == NULL, ERR_FAILURE, (WynnItemNameHash){0});
+    nameHash.slotMask = (uint32_t)(slotCount - 1);
+
+    for (size_t i = 0; i < itemCount; i++)
+    {
+        WynnItem* pItem = wynnitem_list_get(pItemList, i);
+        WynnItemName normalized;
+        size_t length = wynnitem_name_normalize(wynnitem_name(pItem)->str, &normalized);
+        uint64_t hash = name_hash(normalized.str, length);
+
+        WynnItemNameSlot* pSlot = name_hash_probe(&nameHash, &normalized, hash);
+        if (pSlot->hash != 0) continue;
+        *pSlot = (WynnItemNameSlot){hash, pItem};
+        nameHash.count++;
+    }
+
+    return nameHash;
+}
+
+void wynnitem_name_hash_destroy(WynnItemNameHash* pHash)
+{
+    free(pHash->pSlots);
+    *pHash = (WynnItemNameHash){0};
+}
+
+WynnItem* wynnitem_name_hash_find(WynnItemNameHash* pHash, const char* name)
+{
+    if (pHash->pSlots == NULL) return NULL;
+
+    WynnItemName normalized;
+    size_t length = wynnitem_name_normalize(name, &normalized);
+    return name_hash_probe(pHash, &normalized, name_hash(normalized.str, length))->pItem;
+}
+
+// ################################################################################
+// Normalized name table
+//
+//
+// ################################################################################
+
+static inline uint32_t name_class(uint8_t c)
+{
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= '0' && c <= '9') return 26 + c - '0';
+    if (c == ' ') return 36;
+    if (c == '\'') return 37;
+    if (c == '-') return 38;
+    return 39 + c % (64 - 39);
+}
+
+uint64_t wynnitem_name_classes(const char* name, size_t length)
+{
+    uint64_t classes = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        classes |= 1ULL << name_class((uint8_t)name[i]);
+    }
+    return classes;
+}
+
+WynnItemNameTable wynnitem_name_table_create(WynnItemList* pItemList)
+{
+    WynnItemNameTable table = {0};
+    table.count = (uint32_t)wynnitem_list_size(pItemList);
+    if (table.count == 0) return table;
+
+    // [names][classes][lengths], names first so every array stays aligned
+    table.pMemory = malloc(table.count * (sizeof(WynnItemName) + sizeof(uint64_t) + sizeof(uint8_t)));
+    ERR_RET(table.pMemory == NULL, ERR_FAILURE, (WynnItemNameTable){0});
+    table.pNames = table.pMemory;
+    table.pClasses = (uint64_t*)(table.pNames + table.count);
+    table.pLengths = (uint8_t*)(table.pClasses + table.count);
+
+    for (uint32_t row = 0; row < table.count; row++)
+    {
+        size_t length = wynnitem_name_normalize(wynnitem_name(wynnitem_list_get(pItemList, row))->str, &table.pNames[row]);
+        table.pLengths[row] = (uint8_t)length;
+        table.pClasses[row] = wynnitem_name_classes(table.pNames[row].str, length);
+    }
+
+    return table;
+}
+
+void wynnitem_name_table_destroy(WynnItemNameTable* pTable)
+{
+    free(pTable->pMemory);
+    *pTable = (WynnItemNameTable){0};
+}
@@ -0,0 +1,71 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include "wynnitems.h"
+
+/// @brief Trims surrounding whitespace, folds ASCII letters to lower case and accented latin letters
+//  (UTF-8 U+00C0 - U+00FF) to their plain ASCII letter
+/// @param[in] name NULL terminated name
+/// @param[out] pOut Normalized name, NULL terminated and zero padded
+/// @return Length of the normalized name
+size_t wynnitem_name_normalize(const char* name, WynnItemName* pOut);
+
+// Open addressing table from normalized names to items, one probe for the common exact hit
+typedef struct
+{
+    uint64_t hash;      // 0 marks an empty slot
+    WynnItem* pItem;
+} WynnItemNameSlot;
+
+struct WynnItemNameHash
+{
+    WynnItemNameSlot* pSlots;
+    uint32_t slotMask;  // Slot count is a power of two
+    uint32_t count;
+};
+typedef struct WynnItemNameHash WynnItemNameHash;
+
+/// @brief Hashes every normalized item name, the first item wins if two names normalize the same
+/// @param[in] pItemList Items, names have to stay valid for the life of the table
+/// @return Table, destroy with wynnitem_name_hash_destroy
+WynnItemNameHash wynnitem_name_hash_create(WynnItemList* pItemList);
+void wynnitem_name_hash_destroy(WynnItemNameHash* pHash);
+
+/// @brief Item whose normalized name equals the normalized query
+/// @param[in] pHash Table
+/// @param[in] name NULL terminated query
+/// @return Item, NULL if no name matches
+WynnItem* wynnitem_name_hash_find(WynnItemNameHash* pHash, const char* name);
+
+/// @brief Character classes present in a name, one bit each. Letters, digits and the usual
+//  punctuation get their own class, every other byte shares one of the rest.
+/// @param[in] name Name, normalized if it is compared against normalized names
+/// @param length Bytes of name
+/// @return Class bitmap
+uint64_t wynnitem_name_classes(const char* name, size_t length);
+
+/// @brief Lower bound on the edit distance of two names from their class bitmaps. Every class only one
+//  of them has needs its own edit, a substitution fixes at most one such class on each side.
+static inline uint32_t wynnitem_name_class_bound(uint64_t classesA, uint64_t classesB)
+{
+    uint32_t onlyA = (uint32_t)__builtin_popcountll(classesA & ~classesB);
+    uint32_t onlyB = (uint32_t)__builtin_popcountll(classesB & ~classesA);
+    return onlyA > onlyB ? onlyA : onlyB;
+}
+
+// Normalized names of the loaded items, rows are positions in the item list it was built from.
+// Search structures pack their names from here instead of measuring and folding the raw names.
+struct WynnItemNameTable
+{
+    WynnItemName* pNames;   // wynnitem_name_normalize of every name
+    uint64_t* pClasses;     // wynnitem_name_classes of every normalized name
+    uint8_t* pLengths;      // Normalized lengths
+    uint32_t count;
+    void* pMemory;
+};
+typedef struct WynnItemNameTable WynnItemNameTable;
+
+WynnItemNameTable wynnitem_name_table_create(WynnItemList* pItemList);
+void wynnitem_name_table_destroy(WynnItemNameTable* pTable);
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,278 @@
+#include "nametokens.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <LTK/error_handling.h>
+
+static inline bool token_is_separator(uint8_t c)
+{
+    if (c >= 0x80) return false;
+    return !(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z') && !(c >= '0' && c <= '9');
+}
+
+// Next token at or after *pPos, 0 once there are none left
+static size_t token_next(const char* str, size_t length, size_t* pPos, size_t* pStartOut)
+{
+    size_t i = *pPos;
+    while (i < length && token_is_separator((uint8_t)str[i])) i++;
+    *pStartOut = i;
+    while (i < length && !token_is_separator((uint8_t)str[i])) i++;
+    *pPos = i;
+    return i - *pStartOut;
+}
+
+size_t wynnitem_token_count(const char* name)
+{
+    size_t length = strnlen(name, sizeof(WynnItemName) - 1);
+    size_t count = 0, position = 0, start;
+    while (token_next(name, length, &position, &start) > 0) count++;
+    return count;
+}
+
+struct token_entry
+{
+    const char* str;
+    uint32_t row;
+    uint32_t length;
+};
+
+static int token_entry_cmp(const void* pA, const void* pB)
+{
+    const struct token_entry* pEntryA = pA;
+    const struct token_entry* pEntryB = pB;
+    uint32_t length = pEntryA->length < pEntryB->length ? pEntryA->length : pEntryB->length;
+    int cmp = memcmp(pEntryA->str, pEntryB->str, length);
+    if (cmp != 0) return cmp;
+    if (pEntryA->length != pEntryB->length) return pEntryA->length < pEntryB->length ? -1 : 1;
+    return (pEntryA->row > pEntryB->row) - (pEntryA->row < pEntryB->row);
+}
+
+static inline bool token_entry_same(const struct token_entry* pEntryA, const struct token_entry* pEntryB)
+{
+    return pEntryA->length == pEntryB->length && memcmp(pEntryA->str, pEntryB->str, pEntryA->length) == 0;
+}
+
+WynnItemTokenIndex wynnitem_token_index_create(WynnItemNameTable* pTable)
+{
+    WynnItemTokenIndex index = {0};
+    index.count = pTable->count;
+
+    size_t entryCount = 0;
+    for (uint32_t row = 0; row < pTable->count; row++) entryCount += wynnitem_token_count(pTable->pNames[row].str);
+    // No tokens is an index without tokens, matching it returns nothing
+    if (entryCount == 0) return index;
+
+    struct token_entry* pEntries = malloc(entryCount * sizeof(struct token_entry));
+    ERR_RET(pEntries == NULL, ERR_FAILURE, (WynnItemTokenIndex){0});
+    size_t entry = 0;
+    for (uint32_t row = 0; row < pTable->count; row++)
+    {
+        const char* name = pTable->pNames[row].str;
+        size_t position = 0, start, length;
+        while ((length = token_next(name, pTable->pLengths[row], &position, &start)) > 0)
+        {
+            pEntries[entry++] = (struct token_entry){name + start, row, (uint32_t)length};
+        }
+    }
+
+    // Sorted by token then row, a token repeated within a name is one posting
+    qsort(pEntries, entryCount, sizeof(struct token_entry), token_entry_cmp);
+    size_t textSize = 0;
+    for (size_t i = 0; i < entryCount; i++)
+    {
+        if (i > 0 && token_entry_same(&pEntries[i - 1], &pEntries[i]))
+        {
+            if (pEntries[i - 1].row != pEntries[i].row) index.postingCount++;
+            continue;
+        }
+        index.tokenCount++;
+        index.postingCount++;
+        textSize += pEntries[i].length + 1;
+    }
+
+    // At least one token, so none of these are empty
+    index.pText = malloc(textSize);
+    index.pTextOffsets = malloc(index.tokenCount * sizeof(uint32_t));
+    index.pLengths = malloc(index.tokenCount);
+    index.pClasses = malloc(index.tokenCount * sizeof(uint64_t));
+    index.pWeights = malloc(index.tokenCount * sizeof(float));
+    index.pPostingOffsets = malloc((index.tokenCount + 1) * sizeof(uint32_t));
+    index.pPostings = malloc(index.postingCount * sizeof(uint32_t));
+    index.pRowWeights = calloc(index.count, sizeof(float));
+    if (index.pText == NULL || index.pTextOffsets == NULL || index.pLengths == NULL || index.pClasses == NULL ||
+        index.pWeights == NULL || index.pPostingOffsets == NULL || index.pPostings == NULL || index.pRowWeights == NULL)
+    {
+        free(pEntries);
+        wynnitem_token_index_destroy(&index);
+        ERR_RET(true, ERR_FAILURE, (WynnItemTokenIndex){0});
+    }
+
+    uint32_t token = 0, posting = 0, textOffset = 0;
+    for (size_t i = 0; i < entryCount; i++)
+    {
+        const struct token_entry* pEntry = &pEntries[i];
+        if (i == 0 || !token_entry_same(&pEntries[i - 1], pEntry))
+        {
+            index.pTextOffsets[token] = textOffset;
+            memcpy(index.pText + textOffset, pEntry->str, pEntry->length);
+            index.pText[textOffset + pEntry->length] = '\0';
+            textOffset += pEntry->length + 1;
+
+            index.pLengths[token] = (uint8_t)pEntry->length;
+            index.pClasses[token] = wynnitem_name_classes(pEntry->str, pEntry->length);
+            index.pPostingOffsets[token] = posting;
+            token++;
+        }
+        else if (pEntries[i - 1].row == pEntry->row) continue;
+
+        index.pPostings[posting++] = pEntry->row;
+    }
+    index.pPostingOffsets[token] = posting;
+
+    for (token = 0; token < index.tokenCount; token++)
+    {
+        uint32_t rowCount = index.pPostingOffsets[token + 1] - index.pPostingOffsets[token];
+        float weight = logf(1.0f + (float)index.count / (float)rowCount);
+        index.pWeights[token] = weight;
+        index.maxWeight = weight > index.maxWeight ? weight : index.maxWeight;
+
+        for (uint32_t i = index.pPostingOffsets[token]; i < index.pPostingOffsets[token + 1]; i++)
+        {
+            index.pRowWeights[index.pPostings[i]] += weight;
+        }
+    }
+
+    free(pEntries);
+    return index;
+}
+
+void wynnitem_token_index_destroy(WynnItemTokenIndex* pIndex)
+{
+    free(pIndex->pText);
+    free(pIndex->pTextOffsets);
+    free(pIndex->pLengths);
+    free(pIndex->pClasses);
+    free(pIndex->pWeights);
+    free(pIndex->pPostingOffsets);
+    free(pIndex->pPostings);
+    free(pIndex->pRowWeights);
+    *pIndex = (WynnItemTokenIndex){0};
+}
+
+// Longer query tokens may be further off
+static inline uint32_t token_max_dist(uint32_t length)
+{
+    return length <= 3 ? 0 : length <= 6 ? 1 : 2;
+}
+
+// 1 for the same token, less for a close one or a prefix of it, 0 if it doesn't match
+static float token_similarity(const LevenshteinPattern* pPattern, WynnItemTokenIndex* pIndex, uint32_t token, uint32_t maxDist)
+{
+    // Every query class the token lacks takes an edit, for the whole token and any prefix of it
+    if ((uint32_t)__builtin_popcountll(pPattern->classes & ~pIndex->pClasses[token]) > maxDist) return 0.0f;
+    uint32_t length = pIndex->pLengths[token];
+    if (length + maxDist < pPattern->length) return 0.0f;
+
+    const char* text = pIndex->pText + pIndex->pTextOffsets[token];
+    float editPenalty = 1.0f / (float)(pPattern->length + 1);
+    if (length <= pPattern->length + maxDist)
+    {
+        uint32_t distance = levenshtein_myers_bounded(pPattern, text, maxDist);
+        if (distance <= maxDist) return 1.0f - (float)distance * editPenalty;
+    }
+
+    if (pPattern->length < WYNNITEM_TOKEN_PREFIX_MIN) return 0.0f;
+    uint32_t distance = levenshtein_myers_prefix(pPattern, text, length);
+    if (distance > maxDist) return 0.0f;
+
+    float typed = pPattern->length < length ? (float)pPattern->length / (float)length : 1.0f;
+    return (1.0f - (float)distance * editPenalty) * (0.5f + 0.5f * typed);
+}
+
+void wynnitem_token_index_match(WynnItemTokenIndex* pIndex, WynnItemList* pItemList, const char* query, TokenMatchTop* pTop)
+{
+    ERR_RET(pIndex->count != wynnitem_list_size(pItemList), ERR_INVALID_ARGS,);
+    if (pIndex->tokenCount == 0) return;
+
+    WynnItemName normalized;
+    size_t length = wynnitem_name_normalize(query, &normalized);
+
+    // pBest is the best match of the current query token per row, pScores sums them over the query
+    // Tokens come from rows, so there is at least one
+    float* pBest = calloc(3 * (size_t)pIndex->count, sizeof(float));
+    uint32_t* pRows = malloc(2 * (size_t)pIndex->count * sizeof(uint32_t));
+    if (pBest == NULL || pRows == NULL)
+    {
+        free(pRows);
+        free(pBest);
+        ERR_RET(true, ERR_FAILURE,);
+    }
+    float* pScores = pBest + pIndex->count;
+    uint32_t* pTokenRows = pRows + pIndex->count;
+    size_t rowCount = 0;
+
+    float queryWeight = 0.0f;
+    size_t position = 0, start, tokenLength;
+    for (size_t queryToken = 0; queryToken < WYNNITEM_TOKEN_QUERY_MAX; queryToken++)
+    {
+        tokenLength = token_next(normalized.str, length, &position, &start);
+        if (tokenLength == 0) break;
+
+        WynnItemName tokenStr = {0};
+        memcpy(tokenStr.str, normalized.str + start, tokenLength);
+        LevenshteinPattern pattern = levenshtein_pattern(tokenStr.str);
+        uint32_t maxDist = token_max_dist((uint32_t)tokenLength);
+
+        // A query token that matches nothing still counts against the coverage
+        float tokenWeight = 0.0f;
+        size_t tokenRowCount = 0;
+        for (uint32_t token = 0; token < pIndex->tokenCount; token++)
+        {
+            float similarity = token_similarity(&pattern, pIndex, token, maxDist);
+            if (similarity <= 0.0f) continue;
+
+            float weight = similarity * pIndex->pWeights[token];
+            tokenWeight = pIndex->pWeights[token] > tokenWeight ? pIndex->pWeights[token] : tokenWeight;
+            for (uint32_t i = pIndex->pPostingOffsets[token]; i < pIndex->pPostingOffsets[token + 1]; i++)
+            {
+                uint32_t row = pIndex->pPostings[i];
+                if (weight <= pBest[row]) continue;
+                if (pBest[row] == 0.0f) pTokenRows[tokenRowCount++] = row;
+                pBest[row] = weight;
+            }
+        }
+        queryWeight += tokenWeight > 0.0f ? tokenWeight : pIndex->maxWeight;
+
+        for (size_t i = 0; i < tokenRowCount; i++)
+        {
+            uint32_t row = pTokenRows[i];
+            if (pScores[row] == 0.0f) pRows[rowCount++] = row;
+            pScores[row] += pBest[row];
+            pBest[row] = 0.0f;
+        }
+    }
+
+    // Matched rows packed for a branch free scoring pass, pBest is free again
+    float* pPackedScores = pBest;
+    float* pPackedWeights = pScores + pIndex->count;
+    for (size_t i = 0; i < rowCount; i++)
+    {
+        pPackedScores[i] = pScores[pRows[i]];
+        pPackedWeights[i] = pIndex->pRowWeights[pRows[i]];
+    }
+    float queryScale = WYNNITEM_TOKEN_QUERY_SHARE / queryWeight;
+    for (size_t i = 0; i < rowCount; i++)
+    {
+        float nameCoverage = fminf(pPackedScores[i] / pPackedWeights[i], 1.0f);
+        pPackedScores[i] = pPackedScores[i] * queryScale + (1.0f - WYNNITEM_TOKEN_QUERY_SHARE) * nameCoverage;
+    }
+
+    for (size_t i = 0; i < rowCount; i++)
+    {
+        if (pPackedScores[i] < WYNNITEM_TOKEN_MIN_SCORE) continue;
+        token_match_top_push(pTop, (struct scored_item){pPackedScores[i], wynnitem_list_get(pItemList, pRows[i])});
+    }
+
+    free(pRows);
+    free(pBest);
+}
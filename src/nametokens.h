@@ -0,0 +1,65 @@
+#ifndef NAMETOKENS_H
+#define NAMETOKENS_H
+
+#include "wynnitems.h"
+#include "itemsearch.h"
+#include "nameindex.h"
+
+// Items offered for a multi word query
+#define WYNNITEM_TOKEN_TOP_COUNT LEVENSHTEIN_TOP_COUNT
+// Query tokens past this many are ignored
+#define WYNNITEM_TOKEN_QUERY_MAX 16
+// Shortest query token matched against token prefixes, shorter ones have to match a whole token
+#define WYNNITEM_TOKEN_PREFIX_MIN 2
+// Share of the score from covering the query, the rest is from covering the item name
+#define WYNNITEM_TOKEN_QUERY_SHARE 0.75f
+// Items scoring lower aren't offered
+#define WYNNITEM_TOKEN_MIN_SCORE 0.3f
+
+// Higher scores are better
+static inline bool token_match_is_better(const struct scored_item* pItemA, const struct scored_item* pItemB)
+{
+    return pItemA->score > pItemB->score;
+}
+
+TOPK_GENERIC_EX(struct scored_item, TokenMatchTop, token_match_top, WYNNITEM_TOKEN_TOP_COUNT, token_match_is_better);
+
+// Words of the normalized item names (split at anything that isn't a letter or a digit) and the
+// rows each of them is in. Rows are positions in the item list the name table was built from.
+struct WynnItemTokenIndex
+{
+    uint32_t tokenCount;
+    uint32_t count;             // Rows
+    uint32_t postingCount;
+    char* pText;                // Every token NULL terminated
+    uint32_t* pTextOffsets;     // Token t is pText + pTextOffsets[t]
+    uint8_t* pLengths;
+    uint64_t* pClasses;         // wynnitem_name_classes of every token
+    float* pWeights;            // log(1 + rows / rows holding the token), rare words count more
+    uint32_t* pPostingOffsets;  // Token t rows are pPostings[pPostingOffsets[t], pPostingOffsets[t + 1])
+    uint32_t* pPostings;        // Ascending, once per row
+    float* pRowWeights;         // Summed weight of the distinct tokens of every row
+    float maxWeight;
+};
+typedef struct WynnItemTokenIndex WynnItemTokenIndex;
+
+/// @brief Splits every normalized name into tokens
+/// @param[in] pTable Normalized names
+/// @return Index, destroy with wynnitem_token_index_destroy
+WynnItemTokenIndex wynnitem_token_index_create(WynnItemNameTable* pTable);
+void wynnitem_token_index_destroy(WynnItemTokenIndex* pIndex);
+
+/// @brief Number of tokens in a name
+/// @param[in] name NULL terminated name
+size_t wynnitem_token_count(const char* name);
+
+/// @brief Scores items by how much of the query and of their name the query tokens cover, in any
+//  order. A query token matches index tokens within a small edit distance of it or of their prefix,
+//  weighted by how close it is and by the token weight.
+/// @param[in] pIndex Index
+/// @param[in] pItemList Items the index rows refer to
+/// @param[in] query NULL terminated query
+/// @param[out] pTop Best items scoring at least WYNNITEM_TOKEN_MIN_SCORE (1 is a perfect match)
+void wynnitem_token_index_match(WynnItemTokenIndex* pIndex, WynnItemList* pItemList, const char* query, TokenMatchTop* pTop);
+
+#endif // NAMETOKENS_H
@@ -0,0 +1,384 @@
+#include "nametrie.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <LTK/error_handling.h>
+#include <LTK/ansi_codes.h>
+#include "timing.h"
+
+#define NAME_TRIE_ROW_SIZE sizeof(WynnItemName)
+
+static inline char name_trie_fold(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+static void name_trie_fold_str(const char* str, char* pOut)
+{
+    size_t i = 0;
+    for (; i < sizeof(WynnItemName) - 1 && str[i] != '\0'; i++) pOut[i] = name_trie_fold(str[i]);
+    pOut[i] = '\0';
+}
+
+struct name_trie_entry
+{
+    WynnItemName folded;
+    WynnItem* pItem;
+};
+
+static int name_trie_entry_cmp(const void* pA, const void* pB)
+{
+    return strcmp(((const struct name_trie_entry*)pA)->folded.str, ((const struct name_trie_entry*)pB)->folded.str);
+}
+
+NameTrie name_trie_create(WynnItemList* pItemList)
+{
+    NameTrie trie = {0};
+    trie.count = wynnitem_list_size(pItemList);
+
+    // No names is just the root, which sessions still need
+    if (trie.count == 0)
+    {
+        trie.pNodes = malloc(sizeof(NameTrieNode));
+        ERR_RET(trie.pNodes == NULL, ERR_FAILURE, (NameTrie){0});
+        trie.pNodes[0] = (NameTrieNode){0, 0, 0, 1, 0, 0};
+        trie.nodeCount = 1;
+        return trie;
+    }
+
+    struct name_trie_entry* pEntries = malloc(trie.count * sizeof(struct name_trie_entry));
+    ERR_RET(pEntries == NULL, ERR_FAILURE, (NameTrie){0});
+    size_t nodeCapacity = 1;
+    for (size_t i = 0; i < trie.count; i++)
+    {
+        pEntries[i].pItem = wynnitem_list_get(pItemList, i);
+        name_trie_fold_str(wynnitem_name(pEntries[i].pItem)->str, pEntries[i].folded.str);
+        nodeCapacity += strlen(pEntries[i].folded.str);
+    }
+    qsort(pEntries, trie.count, sizeof(struct name_trie_entry), name_trie_entry_cmp);
+
+    trie.pNodes = malloc(nodeCapacity * sizeof(NameTrieNode));
+    trie.ppItems = malloc(trie.count * sizeof(WynnItem*));
+    if (trie.pNodes == NULL || trie.ppItems == NULL)
+    {
+        free(pEntries);
+        name_trie_destroy(&trie);
+        ERR_RET(true, ERR_FAILURE, (NameTrie){0});
+    }
+
+    // Sorted names share their common prefix with the previous one, the path below it is closed
+    // and the rest is appended, which leaves the nodes in preorder
+    uint32_t path[sizeof(WynnItemName)] = {0};
+    size_t pathLength = 0;
+    trie.pNodes[0] = (NameTrieNode){0, 0, 0, 0, 0, (uint32_t)trie.count};
+    trie.nodeCount = 1;
+    const char* previous = "";
+
+    for (size_t i = 0; i < trie.count; i++)
+    {
+        const char* name = pEntries[i].folded.str;
+        trie.ppItems[i] = pEntries[i].pItem;
+
+        size_t common = 0;
+        while (common < pathLength && name[common] == previous[common]) common++;
+        for (; pathLength > common; pathLength--) trie.pNodes[path[pathLength - 1]].subtreeEnd = (uint32_t)trie.nodeCount;
+
+        for (size_t d = common; name[d] != '\0'; d++)
+        {
+            uint32_t parent = d == 0 ? 0 : path[d - 1];
+            trie.pNodes[trie.nodeCount] = (NameTrieNode){(uint8_t)name[d], (uint8_t)(d + 1), parent, 0, (uint32_t)i, 0};
+            path[pathLength++] = (uint32_t)trie.nodeCount++;
+        }
+        for (size_t d = 0; d < pathLength; d++) trie.pNodes[path[d]].nameEnd = (uint32_t)i + 1;
+        previous = name;
+    }
+    for (; pathLength > 0; pathLength--) trie.pNodes[path[pathLength - 1]].subtreeEnd = (uint32_t)trie.nodeCount;
+    trie.pNodes[0].subtreeEnd = (uint32_t)trie.nodeCount;
+
+    free(pEntries);
+    return trie;
+}
+
+void name_trie_destroy(NameTrie* pTrie)
+{
+    free(pTrie->pNodes);
+    free(pTrie->ppItems);
+    *pTrie = (NameTrie){0};
+}
+
+static inline uint8_t* session_row(NameTrieSession* pSession, uint32_t node)
+{
+    return pSession->pRows + (size_t)node * NAME_TRIE_ROW_SIZE;
+}
+
+// Distance from the node prefix to the query prefix of this length, from the parent row
+static inline uint8_t session_cell(NameTrieSession* pSession, uint32_t node, uint32_t column)
+{
+    NameTrieNode* pNode = &pSession->pTrie->pNodes[node];
+    if (column == 0) return pNode->depth;
+
+    uint8_t* pRow = session_row(pSession, node);
+    uint8_t* pParentRow = session_row(pSession, pNode->parent);
+    uint32_t substitute = pParentRow[column - 1] + (pNode->byte != (uint8_t)pSession->query[column - 1]);
+    uint32_t insert = pRow[column - 1] + 1u;
+    uint32_t remove = pParentRow[column] + 1u;
+
+    uint32_t best = substitute < insert ? substitute : insert;
+    return (uint8_t)(best < remove ? best : remove);
+}
+
+// Children come in once anything in the node row is within maxDist, every name below the node
+// goes through that row so nothing below it can be closer than its smallest entry
+static void session_expand(NameTrieSession* pSession)
+{
+    NameTrieNode* pNodes = pSession->pTrie->pNodes;
+    uint32_t length = pSession->length;
+
+    for (size_t i = 0; i < pSession->visitedCount; i++)
+    {
+        uint32_t node = pSession->pVisited[i];
+        if (pSession->pExpanded[node] != 0) continue;
+
+        uint8_t* pRow = session_row(pSession, node);
+        uint8_t rowMin = pRow[0];
+        for (uint32_t column = 1; column <= length; column++) rowMin = pRow[column] < rowMin ? pRow[column] : rowMin;
+        if (rowMin > pSession->maxDist) continue;
+
+        pSession->pExpanded[node] = (uint8_t)(length + 1);
+        for (uint32_t child = node + 1; child < pNodes[node].subtreeEnd; child = pNodes[child].subtreeEnd)
+        {
+            uint8_t* pChildRow = session_row(pSession, child);
+            for (uint32_t column = 0; column <= length; column++) pChildRow[column] = session_cell(pSession, child, column);
+            pSession->pVisited[pSession->visitedCount++] = child;
+        }
+    }
+}
+
+NameTrieSession name_trie_session_create(NameTrie* pTrie, uint32_t maxDist)
+{
+    NameTrieSession session = {0};
+    ERR_RET(pTrie == NULL || pTrie->nodeCount == 0, ERR_INVALID_ARGS, session);
+    session.pTrie = pTrie;
+    session.maxDist = maxDist;
+
+    session.pRows = calloc(pTrie->nodeCount, NAME_TRIE_ROW_SIZE);
+    session.pExpanded = calloc(pTrie->nodeCount, 1);
+    session.pVisited = malloc(pTrie->nodeCount * sizeof(uint32_t));
+    if (session.pRows == NULL || session.pExpanded == NULL || session.pVisited == NULL)
+    {
+        name_trie_session_destroy(&session);
+        ERR_RET(true, ERR_FAILURE, (NameTrieSession){0});
+    }
+
+    session.pVisited[session.visitedCount++] = 0;
+    session_expand(&session);
+    session.visitedCounts[0] = session.visitedCount;
+
+    return session;
+}
+
+void name_trie_session_destroy(NameTrieSession* pSession)
+{
+    free(pSession->pRows);
+    free(pSession->pExpanded);
+    free(pSession->pVisited);
+    *pSession = (NameTrieSession){0};
+}
+
+bool name_trie_session_push(NameTrieSession* pSession, char c)
+{
+    if (pSession->length + 1 >= NAME_TRIE_ROW_SIZE) return false;
+
+    pSession->query[pSession->length++] = name_trie_fold(c);
+    uint32_t length = pSession->length;
+
+    // Parents come first so their new cell is ready for the children
+    session_row(pSession, 0)[length] = (uint8_t)length;
+    for (size_t i = 1; i < pSession->visitedCount; i++)
+    {
+        uint32_t node = pSession->pVisited[i];
+        session_row(pSession, node)[length] = session_cell(pSession, node, length);
+    }
+
+    session_expand(pSession);
+    pSession->visitedCounts[length] = pSession->visitedCount;
+    return true;
+}
+
+void name_trie_session_pop(NameTrieSession* pSession)
+{
+    if (pSession->length == 0) return;
+    pSession->length--;
+
+    // Nodes that came in for the removed character go, and so does their parent's expansion.
+    // Earlier columns of the nodes that stay don't depend on it.
+    size_t visitedCount = pSession->visitedCounts[pSession->length];
+    for (size_t i = visitedCount; i < pSession->visitedCount; i++)
+    {
+        uint32_t node = pSession->pVisited[i];
+        pSession->pExpanded[node] = 0;
+        pSession->pExpanded[pSession->pTrie->pNodes[node].parent] = 0;
+    }
+    pSession->visitedCount = visitedCount;
+}
+
+void name_trie_session_set(NameTrieSession* pSession, const char* query)
+{
+    uint32_t common = 0;
+    while (common < pSession->length && query[common] != '\0' &&
+        name_trie_fold(query[common]) == pSession->query[common]) common++;
+
+    while (pSession->length > common) name_trie_session_pop(pSession);
+    for (const char* c = query + common; *c != '\0'; c++)
+    {
+        if (!name_trie_session_push(pSession, *c)) break;
+    }
+}
+
+size_t name_trie_session_suggest(NameTrieSession* pSession, struct levenshtein_item* pItemsOut, size_t count)
+{
+    NameTrie* pTrie = pSession->pTrie;
+    uint32_t length = pSession->length;
+    size_t itemCount = 0;
+
+    // A name first shows up under its closest matching prefix, ancestors come before descendants
+    for (uint32_t distance = 0; distance <= pSession->maxDist && itemCount < count; distance++)
+    {
+        for (size_t i = 0; i < pSession->visitedCount && itemCount < count; i++)
+        {
+            uint32_t node = pSession->pVisited[i];
+            if (session_row(pSession, node)[length] != distance) continue;
+
+            for (uint32_t n = pTrie->pNodes[node].nameStart; n < pTrie->pNodes[node].nameEnd && itemCount < count; n++)
+            {
+                WynnItem* pItem = pTrie->ppItems[n];
+                bool isListed = false;
+                for (size_t j = 0; j < itemCount && !isListed; j++) isListed = pItemsOut[j].pItem == pItem;
+                if (!isListed) pItemsOut[itemCount++] = (struct levenshtein_item){distance, pItem};
+            }
+        }
+    }
+
+    return itemCount;
+}
+
+// Keystroke timings of one benchmark pass, sorted before they are printed
+struct name_trie_keys
+{
+    float* pTimes;
+    size_t count;
+    double total;
+};
+
+static inline void name_trie_keys_add(struct name_trie_keys* pKeys, uint64_t timeStart, uint64_t timeEnd)
+{
+    double time = timing_to_float(timeStart, timeEnd);
+    pKeys->pTimes[pKeys->count++] = (float)time;
+    pKeys->total += time;
+}
+
+static int name_trie_time_cmp(const void* pA, const void* pB)
+{
+    float a = *(const float*)pA;
+    float b = *(const float*)pB;
+    return (a > b) - (a < b);
+}
+
+// A single slow key is usually the thread being preempted, the 99th percentile is what typing feels like
+static void name_trie_keys_print(const char* name, struct name_trie_keys* pKeys)
+{
+    if (pKeys->count == 0) return;
+
+    qsort(pKeys->pTimes, pKeys->count, sizeof(float), name_trie_time_cmp);
+    printf(
+        "  %-6s %8.2lfus per key  %8.2lfus p99  %8.2lfus worst  %zu keys\n",
+        name, pKeys->total * 1000000.0 / (double)pKeys->count, 
+        pKeys->pTimes[pKeys->count * 99 / 100] * 1000000.0, pKeys->pTimes[pKeys->count - 1] * 1000000.0, pKeys->count
+    );
+}
+
+bool name_trie_benchmark(WynnItemList* pItemList, uint32_t maxDist)
+{
+    printf(YELLOW"Building name trie...");
+    uint64_t timeStart = get_timing();
+    NameTrie trie = name_trie_create(pItemList);
+    NameTrieSession session = name_trie_session_create(&trie, maxDist);
+    printf(GREEN"Completed: %.3lfs (%zu nodes)\n"RESET, timing_to_float(timeStart, get_timing()), trie.nodeCount);
+
+    // Each name is typed twice and deleted twice
+    size_t keyCount = 0;
+    for (size_t i = 0; i < trie.count; i++) keyCount += strnlen(wynnitem_name(trie.ppItems[i])->str, sizeof(WynnItemName) - 1);
+    struct name_trie_keys typed = {0}, typo = {0}, deleted = {0};
+    if (keyCount > 0)
+    {
+        typed.pTimes = malloc(keyCount * sizeof(float));
+        typo.pTimes = malloc(keyCount * sizeof(float));
+        deleted.pTimes = malloc(2 * keyCount * sizeof(float));
+    }
+    bool isAllocated = keyCount == 0 || (typed.pTimes != NULL && typo.pTimes != NULL && deleted.pTimes != NULL);
+    if (session.pRows == NULL || !isAllocated)
+    {
+        free(typed.pTimes);
+        free(typo.pTimes);
+        free(deleted.pTimes);
+        name_trie_session_destroy(&session);
+        name_trie_destroy(&trie);
+        ERR_RET(true, ERR_FAILURE, false);
+    }
+
+    // Like the search box, a keystroke is the session update and the suggestions drawn after it.
+    // Every name is typed out then deleted again, once as it is and once with a typo halfway.
+    printf(YELLOW"Typing %zu names (max distance %u)...", trie.count, maxDist);
+    struct levenshtein_item suggestions[LEVENSHTEIN_TOP_COUNT];
+    bool isMatching = true;
+    for (size_t i = 0; i < trie.count; i++)
+    {
+        WynnItemName folded;
+        name_trie_fold_str(wynnitem_name(trie.ppItems[i])->str, folded.str);
+        size_t length = strlen(folded.str);
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (size_t c = 0; c < length; c++)
+            {
+                char key = pass == 1 && c == length / 2 ? (folded.str[c] == 'q' ? 'z' : 'q') : folded.str[c];
+                timeStart = get_timing();
+                name_trie_session_push(&session, key);
+                name_trie_session_suggest(&session, suggestions, LEVENSHTEIN_TOP_COUNT);
+                name_trie_keys_add(pass == 0 ? &typed : &typo, timeStart, get_timing());
+            }
+
+            // The whole name typed is a prefix of itself, the first suggestion is that name
+            if (pass == 0 && length > 0)
+            {
+                size_t suggestionCount = name_trie_session_suggest(&session, suggestions, LEVENSHTEIN_TOP_COUNT);
+                WynnItemName suggested = {0};
+                if (suggestionCount > 0) name_trie_fold_str(wynnitem_name(suggestions[0].pItem)->str, suggested.str);
+                isMatching &= suggestionCount > 0 && suggestions[0].distance == 0 && !strcmp(suggested.str, folded.str);
+            }
+
+            for (size_t c = 0; c < length; c++)
+            {
+                timeStart = get_timing();
+                name_trie_session_pop(&session);
+                name_trie_session_suggest(&session, suggestions, LEVENSHTEIN_TOP_COUNT);
+                name_trie_keys_add(&deleted, timeStart, get_timing());
+            }
+        }
+    }
+
+    if (isMatching)
+        printf(GREEN"Completed\n"RESET);
+    else
+        printf(RED"A typed name is not its own first suggestion\n"RESET);
+    name_trie_keys_print("typed", &typed);
+    name_trie_keys_print("typo", &typo);
+    name_trie_keys_print("delete", &deleted);
+    free(typed.pTimes);
+    free(typo.pTimes);
+    free(deleted.pTimes);
+
+    name_trie_session_destroy(&session);
+    name_trie_destroy(&trie);
+    return isMatching;
+}
@@ -0,0 +1,84 @@
+#ifndef NAMETRIE_H
+#define NAMETRIE_H
+
+#include "wynnitems.h"
+#include "itemsearch.h"
+
+// Edit distance a name prefix may be from the search text and still be suggested
+#define NAME_TRIE_SEARCH_MAX_DIST 2
+
+// Prefix trie over folded item names (ASCII lower case), nodes are stored in preorder so a
+// subtree is the node range [node, subtreeEnd) and the names below a node are a range of
+// the name sorted items
+typedef struct
+{
+    uint8_t byte;
+    uint8_t depth;
+    uint32_t parent;
+    uint32_t subtreeEnd;
+    uint32_t nameStart;     // Items whose folded name starts with this node prefix are
+    uint32_t nameEnd;       // ppItems[nameStart, nameEnd)
+} NameTrieNode;
+
+typedef struct
+{
+    NameTrieNode* pNodes;   // Node 0 is the root (empty prefix)
+    size_t nodeCount;
+    WynnItem** ppItems;     // Sorted by folded name
+    size_t count;
+} NameTrie;
+
+NameTrie name_trie_create(WynnItemList* pItemList);
+void name_trie_destroy(NameTrie* pTrie);
+
+// Query typed so far and the edit distance rows of every trie node it reached. A row holds
+// the distance from the node prefix to each prefix of the query, so typing a character adds
+// one column to the nodes already reached (and rows for the children that came in range)
+// and deleting one only drops what the deleted character reached.
+typedef struct
+{
+    NameTrie* pTrie;
+    uint32_t maxDist;
+    char query[sizeof(WynnItemName)];   // Folded
+    uint32_t length;
+    uint8_t* pRows;                     // Row of node n at n * sizeof(WynnItemName)
+    uint8_t* pExpanded;                 // Query length + 1 when a node added its children, 0 if not yet
+    uint32_t* pVisited;                 // Nodes with a row, parents before their children
+    size_t visitedCount;
+    size_t visitedCounts[sizeof(WynnItemName)];    // visitedCount at each query length
+} NameTrieSession;
+
+/// @brief Starts an empty query
+/// @param[in] pTrie Trie, has to outlive the session
+/// @param maxDist Largest edit distance from the query to a name prefix that still suggests it
+/// @return Session, destroy with name_trie_session_destroy
+NameTrieSession name_trie_session_create(NameTrie* pTrie, uint32_t maxDist);
+void name_trie_session_destroy(NameTrieSession* pSession);
+
+/// @brief Appends a character to the query
+/// @return FALSE if the query is already as long as a name can be
+bool name_trie_session_push(NameTrieSession* pSession, char c);
+
+/// @brief Removes the last character of the query
+void name_trie_session_pop(NameTrieSession* pSession);
+
+/// @brief Moves the query to a new string, only the characters after the common prefix are redone
+/// @param[in] pSession Session
+/// @param[in] query NULL terminated query, for example the contents of a text box every frame
+void name_trie_session_set(NameTrieSession* pSession, const char* query);
+
+/// @brief Names that start with something within maxDist edits of the query, closest first
+/// @param[in] pSession Session
+/// @param[out] pItemsOut Suggestions, distance is from the query to the closest prefix of the name
+/// @param count Maximum number of suggestions
+/// @return Number of suggestions written
+size_t name_trie_session_suggest(NameTrieSession* pSession, struct levenshtein_item* pItemsOut, size_t count);
+
+/// @brief Types every item name into a session one key at a time and deletes it again, as written
+//  and with a typo halfway, and prints the mean and worst time of a key including the suggestions
+/// @param[in] pItemList Items to build the trie from
+/// @param maxDist Session maxDist
+/// @return TRUE if every name typed out in full is its own first suggestion
+bool name_trie_benchmark(WynnItemList* pItemList, uint32_t maxDist);
+
+#endif // NAMETRIE_H
@@ -0,0 +1,22 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+
+/// @brief Wall clock in nanoseconds, for the timings printed by loads and benchmarks
+static inline uint64_t get_timing()
+{
+    struct timespec spec;
+    timespec_get(&spec, TIME_UTC);
+
+    return spec.tv_nsec + spec.tv_sec * 1000000000ULL;
+}
+
+/// @brief Seconds between two get_timing values
+static inline double timing_to_float(uint64_t start, uint64_t end)
+{
+    return ((double)(end - start)) / 1000000000.0;
+}
+
+#endif // TIMING_H
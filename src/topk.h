@@ -0,0 +1,74 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// ################################################################################
+// Top-k Generic Section
+// Keeps the best CAP items pushed into it, like the containers.h generics but header only
+// and without allocations. IS_BETTER(const T* pA, const T* pB) is true if *pA ranks before
+// *pB, it is called directly so it inlines. Items are a heap with the worst kept item on
+// top, a push that can't make it in costs one comparison.
+//
+// ################################################################################
+
+#define CONTAINERS_TOPK_GENERIC_PASTE(T, TS, TF, CAP, IS_BETTER)\
+typedef struct {size_t count; T items[CAP];} TS;\
+\
+static inline TS TF##_create() {\
+    return (TS){0};\
+}\
+static inline size_t TF##_size(TS* pTop) {\
+    return pTop->count;\
+}\
+static inline size_t TF##_capacity() {\
+    return (CAP);\
+}\
+static inline bool TF##_is_full(TS* pTop) {\
+    return pTop->count == (CAP);\
+}\
+static inline T TF##_worst(TS* pTop) {\
+    return pTop->items[0];\
+}\
+static inline bool TF##_accepts(TS* pTop, const T* pData) {\
+    return pTop->count < (CAP) || IS_BETTER(pData, &pTop->items[0]);\
+}\
+static inline void TF##_sift_down(TS* pTop, size_t i) {\
+    for (;;) {\
+        size_t worst = i, left = 2 * i + 1, right = left + 1;\
+        if (left < pTop->count && IS_BETTER(&pTop->items[worst], &pTop->items[left])) worst = left;\
+        if (right < pTop->count && IS_BETTER(&pTop->items[worst], &pTop->items[right])) worst = right;\
+        if (worst == i) return;\
+        T tmp = pTop->items[i]; pTop->items[i] = pTop->items[worst]; pTop->items[worst] = tmp;\
+        i = worst;\
+    }\
+}\
+static inline bool TF##_push(TS* pTop, T data) {\
+    if (pTop->count < (CAP)) {\
+        size_t i = pTop->count++;\
+        while (i > 0 && IS_BETTER(&pTop->items[(i - 1) / 2], &data)) {\
+            pTop->items[i] = pTop->items[(i - 1) / 2];\
+            i = (i - 1) / 2;\
+        }\
+        pTop->items[i] = data;\
+        return true;\
+    }\
+    if (!IS_BETTER(&data, &pTop->items[0])) return false;\
+    pTop->items[0] = data;\
+    TF##_sift_down(pTop, 0);\
+    return true;\
+}\
+/* Best first, the container is left as it was */\
+static inline void TF##_to_array(TS* pTop, T* pMemoryOut) {\
+    for (size_t i = 0; i < pTop->count; i++) {\
+        T data = pTop->items[i];\
+        size_t j = i;\
+        for (; j > 0 && IS_BETTER(&data, &pMemoryOut[j - 1]); j--) pMemoryOut[j] = pMemoryOut[j - 1];\
+        pMemoryOut[j] = data;\
+    }\
+}\
+
+#define TOPK_GENERIC_EX(T, TS, TF, CAP, IS_BETTER) CONTAINERS_TOPK_GENERIC_PASTE(T, TS, TF, CAP, IS_BETTER)
+
+#endif // TOPK_H
@@ -0,0 +1,133 @@
+#include "workerpool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <LTK/threading.h>
+#include <LTK/error_handling.h>
+
+#ifdef PLATFORM_UNIX
+#include <unistd.h>
+#endif
+
+// Every field below the condition is guarded by its mutex
+struct WorkerPool
+{
+    Condition condition;    // Signaled when a job starts, a job finishes or the pool stops
+    Thread threads[WORKER_POOL_MAX_THREADS];
+    size_t threadCount;     // Workers, the caller of worker_pool_run comes on top
+
+    void (*pFunc)(void* pArgs, size_t task);
+    void* pArgs;
+    size_t taskCount;
+    size_t nextTask;
+    size_t doneCount;
+    uint64_t generation;    // Bumped for every job so a worker never runs one twice
+    bool isStopping;
+};
+
+static size_t worker_pool_core_count()
+{
+#ifdef PLATFORM_WINDOWS
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwNumberOfProcessors;
+#elif defined(PLATFORM_UNIX)
+    long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return onlineCores > 0 ? (size_t)onlineCores : 1;
+#endif
+}
+
+// Takes tasks until the job has none left, called and returns with the mutex held
+static void worker_pool_take_tasks(WorkerPool* pPool)
+{
+    while (pPool->nextTask < pPool->taskCount)
+    {
+        size_t task = pPool->nextTask++;
+        mutex_unlock(&pPool->condition.mutex);
+        pPool->pFunc(pPool->pArgs, task);
+        mutex_lock(&pPool->condition.mutex);
+
+        if (++pPool->doneCount == pPool->taskCount)
+            condition_signal(&pPool->condition);
+    }
+}
+
+static int worker_pool_thread(void* pArgs)
+{
+    WorkerPool* pPool = pArgs;
+    uint64_t generation = 0;
+
+    mutex_lock(&pPool->condition.mutex);
+    for (;;)
+    {
+        while (pPool->generation == generation && !pPool->isStopping)
+            condition_wait(&pPool->condition);
+        if (pPool->isStopping) break;
+
+        generation = pPool->generation;
+        worker_pool_take_tasks(pPool);
+    }
+    mutex_unlock(&pPool->condition.mutex);
+
+    return 0;
+}
+
+WorkerPool* worker_pool_create(size_t threadCount)
+{
+    if (threadCount == 0) threadCount = worker_pool_core_count();
+    threadCount = threadCount < WORKER_POOL_MAX_THREADS ? threadCount : WORKER_POOL_MAX_THREADS;
+
+    WorkerPool* pPool = calloc(1, sizeof(WorkerPool));
+    ERR_RET(pPool == NULL, ERR_FAILURE, NULL);
+    pPool->condition = condition_create();
+
+    pPool->threadCount = threadCount - 1;
+    for (size_t i = 0; i < pPool->threadCount; i++)
+    {
+        pPool->threads[i] = thread_start(worker_pool_thread, pPool);
+    }
+
+    return pPool;
+}
+
+void worker_pool_destroy(WorkerPool* pPool)
+{
+    ERR_RET(pPool == NULL, ERR_INVALID_ARGS,);
+
+    mutex_lock(&pPool->condition.mutex);
+    pPool->isStopping = true;
+    condition_signal(&pPool->condition);
+    mutex_unlock(&pPool->condition.mutex);
+
+    for (size_t i = 0; i < pPool->threadCount; i++)
+    {
+        thread_wait(&pPool->threads[i]);
+    }
+    condition_destroy(&pPool->condition);
+    free(pPool);
+}
+
+size_t worker_pool_size(WorkerPool* pPool)
+{
+    return pPool->threadCount + 1;
+}
+
+void worker_pool_run(WorkerPool* pPool, void (*pFunc)(void* pArgs, size_t task), void* pArgs, size_t taskCount)
+{
+    ERR_RET(pPool == NULL || pFunc == NULL, ERR_INVALID_ARGS,);
+    if (taskCount == 0) return;
+
+    mutex_lock(&pPool->condition.mutex);
+    pPool->pFunc = pFunc;
+    pPool->pArgs = pArgs;
+    pPool->taskCount = taskCount;
+    pPool->nextTask = 0;
+    pPool->doneCount = 0;
+    pPool->generation++;
+    condition_signal(&pPool->condition);
+
+    worker_pool_take_tasks(pPool);
+    while (pPool->doneCount < pPool->taskCount)
+        condition_wait(&pPool->condition);
+    mutex_unlock(&pPool->condition.mutex);
+}
@@ -0,0 +1,34 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <stddef.h>
+
+// Threads that stay alive between jobs, a job is taskCount calls of one function spread over
+// the workers and the calling thread
+#ifndef WORKER_POOL_MAX_THREADS
+#define WORKER_POOL_MAX_THREADS 32
+#endif
+
+typedef struct WorkerPool WorkerPool;
+
+/// @brief Starts the workers
+/// @param threadCount Threads working on a job including the caller of worker_pool_run,
+//  0 for one per core (capped at WORKER_POOL_MAX_THREADS)
+/// @return Pool, NULL on failure
+WorkerPool* worker_pool_create(size_t threadCount);
+
+/// @brief Stops and joins the workers
+void worker_pool_destroy(WorkerPool* pPool);
+
+/// @brief Threads working on a job including the caller
+size_t worker_pool_size(WorkerPool* pPool);
+
+/// @brief Calls pFunc(pArgs, i) for every i in [0, taskCount) and returns once all of them did,
+//  the calling thread takes tasks too. Not reentrant, one job at a time per pool.
+/// @param[in] pPool Pool
+/// @param[in] pFunc Task function
+/// @param[in] pArgs Passed to every task
+/// @param taskCount Number of tasks
+void worker_pool_run(WorkerPool* pPool, void (*pFunc)(void* pArgs, size_t task), void* pArgs, size_t taskCount);
+
+#endif // WORKERPOOL_H
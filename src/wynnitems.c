@@ -1,15 +1,37 @@
 #include "wynnitems.h"
 #include "float.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
 #include <LTK/threading.h>
+#include <LTK/error_handling.h>
+#include <LTK/ansi_codes.h>
+#include <LTK/dataio.h>
+#include "featurescan.h"
+#include "featuretree.h"
+#include "featuregraph.h"
+#include "featurematrix.h"
+#include "timing.h"
+#include "binfile.h"
 
 static float sliderValues[WYNNITEM_ID_ARRAY_SIZE] = {0};
 static Mutex sliderValuesMutex = MUTEX_INIT;
 
 static WynnItemIdArray mins = {0};
 static WynnItemIdArray maxs = {0};
+static float scales[WYNNITEM_ID_ARRAY_SIZE] = {0};     // Feature scale of every stat, from mins and maxs
 #define SORTED_ITEMS_COUNT 8
 static WynnItemList sortedItems[SORTED_ITEMS_COUNT] = {0};
+static WynnItemStatTable statTables[SORTED_ITEMS_COUNT] = {0};
+static FeatureTree featureTrees[SORTED_ITEMS_COUNT] = {0};    // Nearest neighbours of the statTables features
+static FeatureGraph featureGraphs[SORTED_ITEMS_COUNT] = {0};  // Approximate ones, built by wynnitems_graphs_init
+static bool isGraphsInit = false;
+static FeatureMatrix featureMatrices[SORTED_ITEMS_COUNT] = {0};    // Exact neighbours of every row, built by wynnitems_neighbours_init
+static bool isMatricesInit = false;
+static uint32_t* itemRows[SORTED_ITEMS_COUNT] = {0};   // Open addressed item to statTables row + 1, 0 is empty
+static size_t itemRowMasks[SORTED_ITEMS_COUNT] = {0};
 // 0 == helmets
 // 1 == chestplates
 // 2 == leggsings
@@ -30,29 +52,163 @@ static inline float distanceSqrd(int32_t a, int32_t b)
     return ((float)b - a) * ((float)b - a);
 }
 
-void wynnitems_init(WynnItemList* pItemList)
+static WynnItemStatTable stat_table_create(WynnItemList* pItemList)
 {
-    for (size_t i = 0; i < SORTED_ITEMS_COUNT; i++)
+    WynnItemStatTable table = {0};
+    size_t lineInts = WYNNITEM_STAT_TABLE_ALIGNMENT / sizeof(int32_t);
+    table.count = wynnitem_list_size(pItemList);
+    table.stride = (table.count + lineInts - 1) / lineInts * lineInts;
+
+    size_t columnsSize = table.stride * WYNNITEM_ID_ARRAY_SIZE * sizeof(int32_t);
+    size_t itemsSize = table.count * sizeof(WynnItem*);
+    table.pMemory = calloc(1, columnsSize + itemsSize + WYNNITEM_STAT_TABLE_ALIGNMENT);
+    ERR_RET(table.pMemory == NULL, ERR_FAILURE, (WynnItemStatTable){0});
+    uintptr_t aligned = ((uintptr_t)table.pMemory + WYNNITEM_STAT_TABLE_ALIGNMENT - 1) & 
+        ~(uintptr_t)(WYNNITEM_STAT_TABLE_ALIGNMENT - 1);
+    table.pColumns = (int32_t*)aligned;
+    table.ppItems = (WynnItem**)(aligned + columnsSize);
+
+    // Row major over items keeps each item read sequential, the columns are written strided once
+    for (size_t row = 0; row < table.count; row++)
     {
-        sortedItems[i] = wynnitem_list_create();
+        WynnItem* pItem = wynnitem_list_get(pItemList, row);
+        table.ppItems[row] = pItem;
+        for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; ++i)
+        {
+            table.pColumns[i * table.stride + row] = pItem->idArray[i];
+        }
+    }
+
+    return table;
+}
+
+static void stat_table_destroy(WynnItemStatTable* pTable)
+{
+    free(pTable->pMemory);
+    free(pTable->pFeatureMemory);
+    *pTable = (WynnItemStatTable){0};
+}
+
+static void stat_table_features(WynnItemStatTable* pTable)
+{
+    free(pTable->pFeatureMemory);
+    size_t columnsSize = pTable->stride * WYNNITEM_ID_ARRAY_SIZE * sizeof(float);
+    size_t normsSize = pTable->stride * sizeof(float);
+    pTable->pFeatureMemory = calloc(1, columnsSize + normsSize + WYNNITEM_STAT_TABLE_ALIGNMENT);
+    if (pTable->pFeatureMemory == NULL)
+    {
+        // Every scan reads the features of all rows, a slot without them is left empty
+        stat_table_destroy(pTable);
+        ERR_RET(true, ERR_FAILURE,);
     }
+    uintptr_t aligned = ((uintptr_t)pTable->pFeatureMemory + WYNNITEM_STAT_TABLE_ALIGNMENT - 1) & 
+        ~(uintptr_t)(WYNNITEM_STAT_TABLE_ALIGNMENT - 1);
+    pTable->pFeatures = (float*)aligned;
+    pTable->pFeatureNorms = (float*)(aligned + columnsSize);
 
     for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; ++i)
     {
-        maxs[i] = INT32_MIN;
-        mins[i] = INT32_MAX;
+        int32_t* pColumn = wynnitem_stat_column(pTable, i);
+        float* pFeatureColumn = wynnitem_feature_column(pTable, i);
+        float scale = scales[i];
+        for (size_t row = 0; row < pTable->count; row++)
+        {
+            float feature = (float)pColumn[row] * scale;
+            pFeatureColumn[row] = feature;
+            pTable->pFeatureNorms[row] += feature * feature;
+        }
+    }
+}
+
+static void feature_graphs_build(bool* pSlots);
+static void feature_matrices_build(bool* pSlots);
+
+static inline size_t item_row_hash(WynnItem* pItem)
+{
+    uint64_t x = (uint64_t)(uintptr_t)pItem * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(x ^ (x >> 32));
+}
+
+static void item_rows_create(size_t slot)
+{
+    WynnItemStatTable* pTable = &statTables[slot];
+    size_t capacity = 16;
+    while (capacity < pTable->count * 2) capacity *= 2;
+    free(itemRows[slot]);
+    itemRows[slot] = calloc(capacity, sizeof(uint32_t));
+    itemRowMasks[slot] = capacity - 1;
+    ERR_RET(itemRows[slot] == NULL, ERR_FAILURE,);
+
+    for (size_t row = 0; row < pTable->count; row++)
+    {
+        size_t i = item_row_hash(pTable->ppItems[row]) & itemRowMasks[slot];
+        while (itemRows[slot][i] != 0) i = (i + 1) & itemRowMasks[slot];
+        itemRows[slot][i] = (uint32_t)(row + 1);
     }
+}
 
-    WynnItem* pItem = NULL;
-    while (wynnitem_list_iter_next(pItemList, &pItem))
+// Row of an item in its slot table, -1 if it isn't in it
+static int64_t item_row(WynnItem* pItem)
+{
+    uint32_t* pRows = itemRows[pItem->type];
+    if (pRows == NULL) return -1;
+
+    size_t mask = itemRowMasks[pItem->type];
+    for (size_t i = item_row_hash(pItem) & mask; pRows[i] != 0; i = (i + 1) & mask)
     {
-        for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; ++i)
+        if (statTables[pItem->type].ppItems[pRows[i] - 1] == pItem) return pRows[i] - 1;
+    }
+    return -1;
+}
+
+// Refills the features, trees, graphs and neighbours of the dirty slots (NULL for all), or of every slot if
+// the scales moved
+static void stat_tables_scale(bool* pDirtySlots)
+{
+    bool isRescaled = false;
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; ++i)
+    {
+        float scale = maxs[i] > mins[i] ? 1.f / ((float)maxs[i] - (float)mins[i]) : 0.f;
+        isRescaled |= scale != scales[i];
+        scales[i] = scale;
+    }
+
+    bool rebuiltSlots[SORTED_ITEMS_COUNT] = {0};
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        if (!isRescaled && pDirtySlots != NULL && !pDirtySlots[slot]) continue;
+        stat_table_features(&statTables[slot]);
+        feature_tree_destroy(&featureTrees[slot]);
+        featureTrees[slot] = feature_tree_create(&statTables[slot]);
+        item_rows_create(slot);
+        rebuiltSlots[slot] = true;
+    }
+    if (isGraphsInit) feature_graphs_build(rebuiltSlots);
+    if (isMatricesInit) feature_matrices_build(rebuiltSlots);
+}
+
+static void stat_table_min_max(WynnItemStatTable* pTable, int32_t* pMins, int32_t* pMaxs)
+{
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; ++i)
+    {
+        int32_t* pColumn = wynnitem_stat_column(pTable, i);
+        int32_t min = pMins[i];
+        int32_t max = pMaxs[i];
+        for (size_t row = 0; row < pTable->count; row++)
         {
-            if (mins[i] > pItem->idArray[i])
-                mins[i] = pItem->idArray[i]; 
-            if (maxs[i] < pItem->idArray[i])
-                maxs[i] = pItem->idArray[i];
-        }    
+            min = pColumn[row] < min ? pColumn[row] : min;
+            max = pColumn[row] > max ? pColumn[row] : max;
+        }
+        pMins[i] = min;
+        pMaxs[i] = max;
+    }
+}
+
+void wynnitems_init(WynnItemList* pItemList)
+{
+    for (size_t i = 0; i < SORTED_ITEMS_COUNT; i++)
+    {
+        sortedItems[i] = wynnitem_list_create();
     }
 
     size_t count = wynnitem_list_size(pItemList);
@@ -71,6 +227,96 @@ void wynnitems_init(WynnItemList* pItemList)
             case WYNNITEM_TYPE_WEAPON: wynnitem_list_append(&sortedItems[7], pItem); break;
         }
     }
+
+    for (size_t i = 0; i < SORTED_ITEMS_COUNT; i++)
+    {
+        statTables[i] = stat_table_create(&sortedItems[i]);
+    }
+
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; ++i)
+    {
+        maxs[i] = INT32_MIN;
+        mins[i] = INT32_MAX;
+    }
+
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        stat_table_min_max(&statTables[slot], mins, maxs);
+    }
+    stat_tables_scale(NULL);
+    feature_scan_kernel();
+}
+
+// Removed items must still be readable here, their values decide which bounds are stale
+void wynnitems_update(WynnItemList* pRemoved, WynnItemList* pAdded)
+{
+    bool dirtySlots[SORTED_ITEMS_COUNT] = {0};
+    bool staleStats[WYNNITEM_ID_ARRAY_SIZE] = {0};
+    bool isAnyStale = false;
+
+    size_t removedCount = pRemoved ? wynnitem_list_size(pRemoved) : 0;
+    for (size_t i = 0; i < removedCount; i++)
+    {
+        WynnItem* pItem = wynnitem_list_get(pRemoved, i);
+        if (pItem->type >= SORTED_ITEMS_COUNT) continue;
+
+        int64_t index = wynnitem_list_indexof(&sortedItems[pItem->type], pItem);
+        if (index < 0) continue;
+        wynnitem_list_remove(&sortedItems[pItem->type], index);
+        dirtySlots[pItem->type] = true;
+
+        // Only a removed extreme can move a bound, everything else is untouched
+        for (size_t j = 0; j < WYNNITEM_ID_ARRAY_SIZE; ++j)
+        {
+            if (pItem->idArray[j] != mins[j] && pItem->idArray[j] != maxs[j]) continue;
+            staleStats[j] = true;
+            isAnyStale = true;
+        }
+    }
+
+    size_t addedCount = pAdded ? wynnitem_list_size(pAdded) : 0;
+    for (size_t i = 0; i < addedCount; i++)
+    {
+        WynnItem* pItem = wynnitem_list_get(pAdded, i);
+        if (pItem->type >= SORTED_ITEMS_COUNT) continue;
+
+        wynnitem_list_append(&sortedItems[pItem->type], pItem);
+        dirtySlots[pItem->type] = true;
+
+        for (size_t j = 0; j < WYNNITEM_ID_ARRAY_SIZE; ++j)
+        {
+            mins[j] = pItem->idArray[j] < mins[j] ? pItem->idArray[j] : mins[j];
+            maxs[j] = pItem->idArray[j] > maxs[j] ? pItem->idArray[j] : maxs[j];
+        }
+    }
+
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        if (!dirtySlots[slot]) continue;
+        stat_table_destroy(&statTables[slot]);
+        statTables[slot] = stat_table_create(&sortedItems[slot]);
+    }
+
+    // Rescan only the stale stat columns of every slot
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE && isAnyStale; ++i)
+    {
+        if (!staleStats[i]) continue;
+
+        int32_t min = INT32_MAX;
+        int32_t max = INT32_MIN;
+        for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+        {
+            int32_t* pColumn = wynnitem_stat_column(&statTables[slot], i);
+            for (size_t row = 0; row < statTables[slot].count; row++)
+            {
+                min = pColumn[row] < min ? pColumn[row] : min;
+                max = pColumn[row] > max ? pColumn[row] : max;
+            }
+        }
+        mins[i] = min;
+        maxs[i] = max;
+    }
+    stat_tables_scale(dirtySlots);
 }
 
 void wynnitems_cleanup()
@@ -78,7 +324,21 @@ void wynnitems_cleanup()
     for (size_t i = 0; i < SORTED_ITEMS_COUNT; i++)
     {
         wynnitem_list_destroy(&sortedItems[i]);
+        stat_table_destroy(&statTables[i]);
+        feature_tree_destroy(&featureTrees[i]);
+        feature_graph_destroy(&featureGraphs[i]);
+        feature_matrix_destroy(&featureMatrices[i]);
+        free(itemRows[i]);
+        itemRows[i] = NULL;
     }
+    isGraphsInit = false;
+    isMatricesInit = false;
+}
+
+WynnItemStatTable* wynnitem_stat_table(WynnItemType type)
+{
+    ERR_RET(type >= SORTED_ITEMS_COUNT, ERR_INVALID_ARGS, NULL);
+    return &statTables[type];
 }
 
 float wynnitem_get_value(size_t index)
@@ -108,24 +368,514 @@ float wynnitem_similarity(WynnItem* pItem, WynnItem* pTestItem)
     return sqrtf(v); // Remove in future
 }
 
-static float item_target_distance(WynnItem* pItem, float* pTargets)
+uint64_t wynnitem_feature_fingerprint(WynnItemStatTable* pTable)
 {
-    float v = 0;
-    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; ++i)
+    uint64_t hash = bin_hash(BIN_HASH_SEED, &pTable->count, sizeof(pTable->count));
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+        hash = bin_hash(hash, wynnitem_feature_column(pTable, i), pTable->count * sizeof(float));
+    return hash;
+}
+
+void wynnitem_features(const float* pStats, float* pFeaturesOut)
+{
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
     {
-        float a = pItem->idArray[i];
-        float b = pTargets[i];
-        v += (b - a) * (b - a);
+        pFeaturesOut[i] = pStats[i] * scales[i];
     }
-    return v;
 }
 
-static float evaluate_build(WynnBuild* pBuild, float* pTargets)
+void wynnitem_item_features(WynnItem* pItem, float* pFeaturesOut)
+{
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        pFeaturesOut[i] = (float)pItem->idArray[i] * scales[i];
+    }
+}
+
+// |q - a|^2 = |q|^2 + |a|^2 - 2 q.a, one multiply add per row and query stat streamed down the
+// columns. Most items only have a few stats so most query columns are 0 and skipped.
+static void feature_scan(WynnItemStatTable* pTable, const float* pFeatures, FeatureScanKernel kernel, float* pDistancesOut)
+{
+    const float* columns[WYNNITEM_ID_ARRAY_SIZE];
+    float weights[WYNNITEM_ID_ARRAY_SIZE];
+    size_t columnCount = 0;
+    float featureNorm = 0.f;
+    for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++)
+    {
+        featureNorm += pFeatures[i] * pFeatures[i];
+        if (pFeatures[i] == 0.f) continue;
+
+        columns[columnCount] = wynnitem_feature_column(pTable, i);
+        weights[columnCount++] = -2.f * pFeatures[i];
+    }
+
+    kernel(columns, weights, columnCount, pTable->pFeatureNorms, featureNorm, pTable->count, pDistancesOut);
+}
+
+void wynnitem_feature_scan(WynnItemStatTable* pTable, const float* pFeatures, float* pDistancesOut)
+{
+    feature_scan(pTable, pFeatures, feature_scan_kernel(), pDistancesOut);
+}
+
+void wynnitem_similarity_scan(WynnItem* pItem, WynnItemStatTable* pTable, float* pScoresOut)
+{
+    float features[WYNNITEM_ID_ARRAY_SIZE];
+    wynnitem_item_features(pItem, features);
+
+    wynnitem_feature_scan(pTable, features, pScoresOut);
+    for (size_t row = 0; row < pTable->count; row++) pScoresOut[row] = sqrtf(pScoresOut[row]);
+}
+
+size_t wynnitem_knn(WynnItem* pItem, size_t k, WynnItem** ppItemsOut, float* pDistancesOut)
+{
+    ERR_RET(pItem->type >= SORTED_ITEMS_COUNT, ERR_INVALID_ARGS, 0);
+    WynnItemStatTable* pTable = &statTables[pItem->type];
+
+    float features[WYNNITEM_ID_ARRAY_SIZE];
+    wynnitem_item_features(pItem, features);
+    if (k == 0) return 0;
+
+    uint32_t* pRows = malloc(k * sizeof(uint32_t));
+    ERR_RET(pRows == NULL, ERR_FAILURE, 0);
+    size_t foundCount = feature_tree_knn(&featureTrees[pItem->type], features, k, pRows, pDistancesOut);
+    for (size_t i = 0; i < foundCount; i++) ppItemsOut[i] = pTable->ppItems[pRows[i]];
+    free(pRows);
+
+    return foundCount;
+}
+
+size_t wynnitem_ann(WynnItem* pItem, size_t k, size_t efSearch, WynnItem** ppItemsOut, float* pDistancesOut)
+{
+    ERR_RET(pItem->type >= SORTED_ITEMS_COUNT, ERR_INVALID_ARGS, 0);
+    ERR_RET(!isGraphsInit, ERR_FAILURE, 0);
+    WynnItemStatTable* pTable = &statTables[pItem->type];
+
+    float features[WYNNITEM_ID_ARRAY_SIZE];
+    wynnitem_item_features(pItem, features);
+
+    if (k == 0) return 0;
+
+    uint32_t* pRows = malloc(k * sizeof(uint32_t));
+    ERR_RET(pRows == NULL, ERR_FAILURE, 0);
+    size_t foundCount = feature_graph_search(&featureGraphs[pItem->type], features, k, efSearch, pRows, pDistancesOut);
+    for (size_t i = 0; i < foundCount; i++) ppItemsOut[i] = pTable->ppItems[pRows[i]];
+    free(pRows);
+
+    return foundCount;
+}
+
+size_t wynnitem_neighbours(WynnItem* pItem, size_t k, WynnItem** ppItemsOut, float* pDistancesOut)
+{
+    ERR_RET(pItem->type >= SORTED_ITEMS_COUNT, ERR_INVALID_ARGS, 0);
+    int64_t row = item_row(pItem);
+    if (!isMatricesInit || row < 0) return 0;
+
+    FeatureMatrix* pMatrix = &featureMatrices[pItem->type];
+    const float* pDistances;
+    const uint32_t* pRows = feature_matrix_row(pMatrix, (size_t)row, &pDistances);
+    size_t count = k < pMatrix->k ? k : pMatrix->k;
+    for (size_t i = 0; i < count; i++)
+    {
+        ppItemsOut[i] = statTables[pItem->type].ppItems[pRows[i]];
+        pDistancesOut[i] = pDistances[i];
+    }
+    return count;
+}
+
+static void item_target_distance_scan(WynnItemStatTable* pTable, float* pTargets, float* pDistancesOut)
+{
+    float features[WYNNITEM_ID_ARRAY_SIZE];
+    wynnitem_features(pTargets, features);
+    wynnitem_feature_scan(pTable, features, pDistancesOut);
+}
+
+bool wynnitems_feature_benchmark(size_t iterations)
+{
+    ERR_RET(iterations == 0, ERR_INVALID_ARGS, false);
+
+    FeatureScanKernel kernels[FEATURE_SCAN_MAX_KERNELS];
+    const char* kernelNames[FEATURE_SCAN_MAX_KERNELS];
+    size_t kernelCount = feature_scan_kernels(kernels, kernelNames);
+    double times[FEATURE_SCAN_MAX_KERNELS] = {0};
+    bool isMatching = true;
+
+    // Every item of a slot is a query against its own slot, like scored_items_print
+    size_t maxCount = 0, rowCount = 0;
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        maxCount = statTables[slot].count > maxCount ? statTables[slot].count : maxCount;
+        rowCount += statTables[slot].count * statTables[slot].count;
+    }
+    ERR_RET(maxCount == 0, ERR_INVALID_ARGS, false);
+    float* pReference = malloc(maxCount * sizeof(float));
+    float* pDistances = malloc(maxCount * sizeof(float));
+    if (pReference == NULL || pDistances == NULL)
+    {
+        free(pDistances);
+        free(pReference);
+        ERR_RET(true, ERR_FAILURE, false);
+    }
+
+    for (size_t k = 0; k < kernelCount; k++)
+    {
+        printf(YELLOW"Benchmarking %s feature scan (%zu passes)...", kernelNames[k], iterations);
+        bool isEqual = true;
+
+        for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+        {
+            WynnItemStatTable* pTable = &statTables[slot];
+            for (size_t query = 0; query < pTable->count; query++)
+            {
+                float features[WYNNITEM_ID_ARRAY_SIZE];
+                wynnitem_item_features(pTable->ppItems[query], features);
+
+                uint64_t timeStart = get_timing();
+                for (size_t it = 0; it < iterations; it++) feature_scan(pTable, features, kernels[k], pDistances);
+                times[k] += timing_to_float(timeStart, get_timing());
+
+                // FMA rounds once where scalar rounds twice, the error grows with the magnitudes summed
+                feature_scan(pTable, features, kernels[0], pReference);
+                float featureNorm = 0.f;
+                for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++) featureNorm += features[i] * features[i];
+                for (size_t row = 0; row < pTable->count && isEqual; row++)
+                {
+                    float tolerance = WYNNITEM_FEATURE_EPSILON * (1.f + featureNorm + pTable->pFeatureNorms[row]);
+                    isEqual = fabsf(pDistances[row] - pReference[row]) <= tolerance;
+                }
+            }
+        }
+        isMatching &= isEqual;
+
+        if (isEqual)
+            printf(GREEN"Completed\n"RESET);
+        else
+            printf(RED"Differs from scalar\n"RESET);
+    }
+
+    for (size_t k = 0; k < kernelCount; k++)
+    {
+        printf(
+            "  %-7s %8.3lfms per pass  %8.1lf M items/s  %5.2lfx scalar%s\n",
+            kernelNames[k], times[k] * 1000.0 / (double)iterations, 
+            (double)rowCount * (double)iterations / times[k] / 1000000.0, 
+            times[0] / times[k], kernels[k] == feature_scan_kernel() ? "  (used)" : ""
+        );
+    }
+
+    free(pDistances);
+    free(pReference);
+    return isMatching;
+}
+
+static void feature_graphs_build(bool* pSlots)
+{
+    printf(YELLOW"Building feature graphs...");
+    uint64_t timeStart = get_timing();
+
+    // Without a pool the graphs are built on this thread
+    WorkerPool* pPool = worker_pool_create(0);
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        if (!pSlots[slot]) continue;
+        feature_graph_destroy(&featureGraphs[slot]);
+        featureGraphs[slot] = feature_graph_create(&statTables[slot], FEATURE_GRAPH_PARAMS_DEFAULT, pPool);
+    }
+    if (pPool != NULL) worker_pool_destroy(pPool);
+
+    printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, get_timing()));
+}
+
+// Graph and neighbour caches, a header then one serialized block per slot in order
+struct slot_cache_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t param;     // What every block was built with, M of the graphs or k of the neighbours
+    uint64_t size;      // Bytes after the header
+    uint64_t checksum;  // bin_hash of those bytes
+};
+
+// The blocks of a cache file if its header matches, NULL otherwise. Free the file with
+// slot_cache_free.
+static uint8_t* slot_cache_read(char* path, uint32_t magic, uint32_t version, uint32_t param, size_t* pSizeOut)
+{
+    size_t size = 0;
+    uint8_t* pData = dataio_isfile(path) ? dataio_read(path, &size) : NULL;
+    struct slot_cache_header header = {0};
+    if (pData != NULL && size >= sizeof(header)) memcpy(&header, pData, sizeof(header));
+    bool isValid = header.magic == magic && header.version == version && header.slotCount == SORTED_ITEMS_COUNT &&
+        header.param == param && header.size == size - sizeof(header) &&
+        header.checksum == bin_hash(BIN_HASH_SEED, pData + sizeof(header), header.size);
+    if (!isValid)
+    {
+        free(pData);
+        return NULL;
+    }
+
+    *pSizeOut = header.size;
+    return pData + sizeof(header);
+}
+
+static void slot_cache_free(uint8_t* pBlocks)
+{
+    if (pBlocks != NULL) free(pBlocks - sizeof(struct slot_cache_header));
+}
+
+// pData has room for the header in front of size bytes of blocks
+static bool slot_cache_write(char* path, uint32_t magic, uint32_t version, uint32_t param, uint8_t* pData, size_t size)
+{
+    struct slot_cache_header header = {
+        .magic = magic,
+        .version = version,
+        .slotCount = SORTED_ITEMS_COUNT,
+        .param = param,
+        .size = size,
+        .checksum = bin_hash(BIN_HASH_SEED, pData + sizeof(header), size),
+    };
+    memcpy(pData, &header, sizeof(header));
+    return bin_file_replace(path, pData, sizeof(header) + size);
+}
+
+#define GRAPHS_CACHE_MAGIC 0x474E5957u // "WYNG"
+#define GRAPHS_CACHE_VERSION 2
+
+bool wynnitems_graphs_init(char* cachePath)
+{
+    size_t size = 0;
+    uint8_t* pBlocks = slot_cache_read(cachePath, GRAPHS_CACHE_MAGIC, GRAPHS_CACHE_VERSION, FEATURE_GRAPH_M, &size);
+
+    // Slots are stored in order, a graph that can't be read makes the rest unreadable too
+    const uint8_t* pCache = pBlocks;
+    bool staleSlots[SORTED_ITEMS_COUNT] = {0};
+    bool isAnyStale = false;
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        feature_graph_destroy(&featureGraphs[slot]);
+        size_t readSize = 0;
+        if (pCache != NULL && size > 0)
+            readSize = feature_graph_load(pCache, size, &statTables[slot], FEATURE_GRAPH_PARAMS_DEFAULT, &featureGraphs[slot]);
+        pCache = readSize > 0 ? pCache + readSize : NULL;
+        size -= readSize;
+
+        // A graph that wasn't loaded is left zeroed, an empty one still has its fingerprint
+        staleSlots[slot] = featureGraphs[slot].fingerprint == 0;
+        isAnyStale |= staleSlots[slot];
+    }
+    slot_cache_free(pBlocks);
+
+    isGraphsInit = true;
+    if (!isAnyStale) return true;
+
+    feature_graphs_build(staleSlots);
+    return wynnitems_graphs_save(cachePath);
+}
+
+bool wynnitems_graphs_save(char* cachePath)
+{
+    ERR_RET(!isGraphsInit, ERR_FAILURE, false);
+
+    size_t size = 0;
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++) size += feature_graph_size(&featureGraphs[slot]);
+    uint8_t* pData = malloc(sizeof(struct slot_cache_header) + size);
+    ERR_RET(pData == NULL, ERR_FAILURE, false);
+
+    uint8_t* pOut = pData + sizeof(struct slot_cache_header);
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        feature_graph_serialize(&featureGraphs[slot], pOut);
+        pOut += feature_graph_size(&featureGraphs[slot]);
+    }
+
+    bool isWritten = slot_cache_write(cachePath, GRAPHS_CACHE_MAGIC, GRAPHS_CACHE_VERSION, FEATURE_GRAPH_M, pData, size);
+    free(pData);
+    return isWritten;
+}
+
+static void feature_matrices_build(bool* pSlots)
+{
+    printf(YELLOW"Computing item neighbours...");
+    uint64_t timeStart = get_timing();
+
+    WorkerPool* pPool = worker_pool_create(0);
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        if (!pSlots[slot]) continue;
+        feature_matrix_destroy(&featureMatrices[slot]);
+        featureMatrices[slot] = feature_matrix_create(&statTables[slot], FEATURE_MATRIX_K, pPool);
+    }
+    if (pPool != NULL) worker_pool_destroy(pPool);
+
+    printf(GREEN"Completed: %.3lfs\n"RESET, timing_to_float(timeStart, get_timing()));
+}
+
+#define NEIGHBOURS_CACHE_MAGIC 0x4B4E5957u // "WYNK"
+#define NEIGHBOURS_CACHE_VERSION 2
+
+bool wynnitems_neighbours_init(char* cachePath)
+{
+    size_t size = 0;
+    uint8_t* pBlocks = slot_cache_read(cachePath, NEIGHBOURS_CACHE_MAGIC, NEIGHBOURS_CACHE_VERSION, FEATURE_MATRIX_K, &size);
+
+    // Slots are stored in order, a matrix that can't be read makes the rest unreadable too
+    const uint8_t* pCache = pBlocks;
+    bool staleSlots[SORTED_ITEMS_COUNT] = {0};
+    bool isAnyStale = false;
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        feature_matrix_destroy(&featureMatrices[slot]);
+        size_t readSize = 0;
+        if (pCache != NULL && size > 0)
+            readSize = feature_matrix_load(pCache, size, &statTables[slot], FEATURE_MATRIX_K, &featureMatrices[slot]);
+        pCache = readSize > 0 ? pCache + readSize : NULL;
+        size -= readSize;
+
+        // Same as the graphs, only a matrix that was loaded has a fingerprint
+        staleSlots[slot] = featureMatrices[slot].fingerprint == 0;
+        isAnyStale |= staleSlots[slot];
+    }
+    slot_cache_free(pBlocks);
+
+    isMatricesInit = true;
+    if (!isAnyStale) return true;
+
+    feature_matrices_build(staleSlots);
+    return wynnitems_neighbours_save(cachePath);
+}
+
+bool wynnitems_neighbours_save(char* cachePath)
+{
+    ERR_RET(!isMatricesInit, ERR_FAILURE, false);
+
+    size_t size = 0;
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++) size += feature_matrix_size(&featureMatrices[slot]);
+    uint8_t* pData = malloc(sizeof(struct slot_cache_header) + size);
+    ERR_RET(pData == NULL, ERR_FAILURE, false);
+
+    uint8_t* pOut = pData + sizeof(struct slot_cache_header);
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        feature_matrix_serialize(&featureMatrices[slot], pOut);
+        pOut += feature_matrix_size(&featureMatrices[slot]);
+    }
+
+    bool isWritten = slot_cache_write(cachePath, NEIGHBOURS_CACHE_MAGIC, NEIGHBOURS_CACHE_VERSION, FEATURE_MATRIX_K, pData, size);
+    free(pData);
+    return isWritten;
+}
+
+// Exact k closest rows from a full scan, the k-th distance is what a graph result has to beat
+static void feature_scan_top(WynnItemStatTable* pTable, const float* pFeatures, size_t k, float* pDistances, float* pTopOut)
+{
+    wynnitem_feature_scan(pTable, pFeatures, pDistances);
+
+    size_t topCount = 0;
+    for (size_t row = 0; row < pTable->count; row++)
+    {
+        float distance = sqrtf(pDistances[row]);
+        if (topCount == k && distance >= pTopOut[k - 1]) continue;
+
+        size_t i = topCount < k ? topCount++ : k - 1;
+        for (; i > 0 && pTopOut[i - 1] > distance; i--) pTopOut[i] = pTopOut[i - 1];
+        pTopOut[i] = distance;
+    }
+}
+
+bool wynnitems_graph_benchmark(size_t k)
+{
+    ERR_RET(k == 0 || !isGraphsInit, ERR_INVALID_ARGS, false);
+
+    size_t maxCount = 0, queryCount = 0;
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        maxCount = statTables[slot].count > maxCount ? statTables[slot].count : maxCount;
+        queryCount += statTables[slot].count;
+    }
+    ERR_RET(queryCount == 0, ERR_FAILURE, false);
+    float* pDistances = malloc(maxCount * sizeof(float));
+    float* pTruth = malloc(queryCount * k * sizeof(float));
+    float* pFound = malloc(k * sizeof(float));
+    uint32_t* pRows = malloc(k * sizeof(uint32_t));
+    if (pDistances == NULL || pTruth == NULL || pFound == NULL || pRows == NULL)
+    {
+        free(pDistances);
+        free(pTruth);
+        free(pFound);
+        free(pRows);
+        ERR_RET(true, ERR_FAILURE, false);
+    }
+
+    // Ground truth is the brute force scan of the same scaled distance the graphs are built on
+    printf(YELLOW"Benchmarking brute force top %zu...", k);
+    uint64_t timeStart = get_timing();
+    size_t query = 0, truthCount = 0;
+    for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+    {
+        WynnItemStatTable* pTable = &statTables[slot];
+        for (size_t row = 0; row < pTable->count; row++, query++)
+        {
+            float features[WYNNITEM_ID_ARRAY_SIZE];
+            wynnitem_item_features(pTable->ppItems[row], features);
+            feature_scan_top(pTable, features, k, pDistances, pTruth + query * k);
+        }
+        truthCount += pTable->count * (k < pTable->count ? k : pTable->count);
+    }
+    double bruteTime = timing_to_float(timeStart, get_timing());
+    printf(GREEN"Completed\n"RESET);
+
+    printf("  %-10s %9s %12s %9s\n", "efSearch", "recall@k", "us/query", "speedup");
+    printf("  %-10s %9.4lf %12.2lf %9.2lfx\n", "brute", 1.0, bruteTime * 1000000.0 / (double)queryCount, 1.0);
+
+    // A row as close as the k-th true one counts as found, items with the same stats tie
+    size_t efSearches[] = {8, 16, 32, FEATURE_GRAPH_EF_SEARCH, 64, 128, 256};
+    for (size_t e = 0; e < sizeof(efSearches) / sizeof(efSearches[0]); e++)
+    {
+        size_t efSearch = efSearches[e] > k ? efSearches[e] : k;
+        size_t hitCount = 0;
+        double graphTime = 0.0;
+        query = 0;
+        for (size_t slot = 0; slot < SORTED_ITEMS_COUNT; slot++)
+        {
+            WynnItemStatTable* pTable = &statTables[slot];
+            size_t slotK = k < pTable->count ? k : pTable->count;
+            for (size_t row = 0; row < pTable->count; row++, query++)
+            {
+                float features[WYNNITEM_ID_ARRAY_SIZE];
+                wynnitem_item_features(pTable->ppItems[row], features);
+
+                float featureNorm = 0.f;
+                for (size_t i = 0; i < WYNNITEM_ID_ARRAY_SIZE; i++) featureNorm += features[i] * features[i];
+
+                timeStart = get_timing();
+                size_t foundCount = feature_graph_search(&featureGraphs[slot], features, k, efSearch, pRows, pFound);
+                graphTime += timing_to_float(timeStart, get_timing());
+
+                float bound = pTruth[query * k + slotK - 1];
+                // Scan error as in wynnitems_feature_benchmark, with |a|^2 <= 2|q|^2 + 2d^2
+                float tolerance = sqrtf(WYNNITEM_FEATURE_EPSILON * (1.f + 3.f * featureNorm + 2.f * bound * bound));
+                for (size_t i = 0; i < foundCount; i++) hitCount += pFound[i] <= bound + tolerance;
+            }
+        }
+
+        printf(
+            "  %-10zu %9.4lf %12.2lf %9.2lfx\n", efSearch, (double)hitCount / (double)truthCount,
+            graphTime * 1000000.0 / (double)queryCount, bruteTime / graphTime
+        );
+    }
+
+    free(pDistances);
+    free(pTruth);
+    free(pFound);
+    free(pRows);
+    return true;
+}
+
+static float evaluate_build(size_t* pRows, float** ppDistances, size_t* pSlots)
 {
     float accum = 0.f;
-    for (size_t i = 0; i < 9; i++)
+    for (size_t i = 0; i < BUILD_SIZE; i++)
     {
-        accum += item_target_distance(pBuild->pItems[i], pTargets);
+        accum += ppDistances[pSlots[i]][pRows[i]];
     }
     return accum;
 }
@@ -142,26 +892,53 @@ WynnBuild wynnitems_calculate_build(size_t numIters)
         targets[i] = lerp(mins[i], maxs[i], sliderValues[i] + .5f);
     }
 
+    // A build needs an item in every slot
+    for (size_t i = 0; i < SORTED_ITEMS_COUNT; i++)
+    {
+        if (statTables[i].count == 0) return build;
+    }
+
+    // Targets are fixed for the whole search so every item distance is computed once up front
+    float* pDistances[SORTED_ITEMS_COUNT] = {0};
+    for (size_t i = 0; i < SORTED_ITEMS_COUNT; i++)
+    {
+        pDistances[i] = malloc(statTables[i].count * sizeof(float));
+        if (pDistances[i] == NULL)
+        {
+            for (size_t j = 0; j < i; j++) free(pDistances[j]);
+            ERR_RET(true, ERR_FAILURE, build);
+        }
+        item_target_distance_scan(&statTables[i], targets, pDistances[i]);
+    }
+
     size_t indices[] = {0, 1, 2, 3, 4, 4, 5, 6, 7};
-    for (size_t i = 0; i < 9; ++i)
+    size_t rows[BUILD_SIZE];
+    for (size_t i = 0; i < BUILD_SIZE; ++i)
     {
-        WynnItemList* pList = &sortedItems[indices[i]];
-        size_t randomIndex = rand() % wynnitem_list_size(pList);
-        build.pItems[i] = wynnitem_list_get(pList, randomIndex);
+        rows[i] = rand() % statTables[indices[i]].count;
     }
 
-    float lowestScore = evaluate_build(&build, targets);
+    float lowestScore = evaluate_build(rows, pDistances, indices);
     for (size_t iter = 0, i = 0; iter < numIters; ++iter, i = iter % 9)
     {
-        WynnBuild buildCopy = build;
-        WynnItemList* pList = &sortedItems[indices[i]];
-        size_t randomIndex = rand() % wynnitem_list_size(pList);
-        buildCopy.pItems[i] = wynnitem_list_get(pList, randomIndex);
-        float score = evaluate_build(&buildCopy, targets);
+        size_t rowsCopy[BUILD_SIZE];
+        memcpy(rowsCopy, rows, sizeof(rows));
+        rowsCopy[i] = rand() % statTables[indices[i]].count;
+        float score = evaluate_build(rowsCopy, pDistances, indices);
         if (score < lowestScore) continue;
         
         lowestScore = score;
-        build = buildCopy;
+        memcpy(rows, rowsCopy, sizeof(rows));
+    }
+
+    for (size_t i = 0; i < BUILD_SIZE; ++i)
+    {
+        build.pItems[i] = statTables[indices[i]].ppItems[rows[i]];
+    }
+
+    for (size_t i = 0; i < SORTED_ITEMS_COUNT; i++)
+    {
+        free(pDistances[i]);
     }
 
     return build;
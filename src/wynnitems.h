@@ -435,13 +435,14 @@ struct wynnitem_ids{
 };
 
 #define WYNNITEM_ID_ARRAY_SIZE\
-    sizeof(struct wynnitem_reqs) / sizeof(int32_t) +\
+    (sizeof(struct wynnitem_reqs) / sizeof(int32_t) +\
     sizeof(struct wynnitem_base) / sizeof(int32_t) +\
-    sizeof(struct wynnitem_ids) / sizeof(int32_t)
+    sizeof(struct wynnitem_ids) / sizeof(int32_t))
 typedef int32_t WynnItemIdArray[WYNNITEM_ID_ARRAY_SIZE];
 
 typedef struct {
-    WynnItemName* pName;
+    // Self-relative byte offset to the item name so records stay valid when memory mapped
+    int64_t nameOffset;
     WynnItemType type;
     WynnItemTier tier;
     WynnItemClass class;
@@ -459,10 +460,70 @@ typedef struct {
     };
 } WynnItem;
 
+static inline WynnItemName* wynnitem_name(WynnItem* pItem)
+{
+    return (WynnItemName*)((uint8_t*)pItem + pItem->nameOffset);
+}
+
+static inline void wynnitem_name_set(WynnItem* pItem, WynnItemName* pName)
+{
+    pItem->nameOffset = (int64_t)((uint8_t*)pName - (uint8_t*)pItem);
+}
+
 POOL_GENERIC_EX(WynnItem, WynnItemPool, wynnitem_pool)
 POOL_GENERIC_EX(WynnItemName, WynnItemNamePool, wynnitem_name_pool)
 LIST_GENERIC_EX(WynnItem*, WynnItemList, wynnitem_list)
 
+// Structure of arrays copy of every idArray stat for one item slot.
+// Column i holds stat i for every item in the slot, so scans over a few stats stream linearly.
+// Columns stay dense even though most stats of an item are 0, the feature kernels score a whole
+// block of rows per column and only the query side is cut to its non zero stats.
+#define WYNNITEM_STAT_TABLE_ALIGNMENT 64
+typedef struct
+{
+    size_t count;       // Rows (items)
+    size_t stride;      // Column stride in int32_t, count padded to a full cache line
+    int32_t* pColumns;  // WYNNITEM_ID_ARRAY_SIZE columns, each 64 byte aligned
+    WynnItem** ppItems; // Row to item
+    void* pMemory;
+
+    // Every stat scaled by 1 / (max - min) over all slots so no stat outweighs the others by its
+    // units alone. Same column layout as pColumns, refreshed whenever the bounds move.
+    float* pFeatures;
+    float* pFeatureNorms;       // Squared feature norm of every row
+    void* pFeatureMemory;
+} WynnItemStatTable;
+
+static inline int32_t* wynnitem_stat_column(WynnItemStatTable* pTable, size_t stat)
+{
+    return pTable->pColumns + stat * pTable->stride;
+}
+
+static inline float* wynnitem_feature_column(WynnItemStatTable* pTable, size_t stat)
+{
+    return pTable->pFeatures + stat * pTable->stride;
+}
+
+// Features per row when a table is copied to rows (one point per item), padded so distances run
+// in whole vectors
+#define WYNNITEM_FEATURE_POINT_SIZE ((WYNNITEM_ID_ARRAY_SIZE + 7) / 8 * 8)
+
+// Squared distance between two rows of WYNNITEM_FEATURE_POINT_SIZE features
+static inline float wynnitem_point_distance_sqrd(const float* pA, const float* pB)
+{
+    // One sum per lane vectorizes without reassociating the float adds
+    float sums[8] = {0};
+    for (size_t i = 0; i < WYNNITEM_FEATURE_POINT_SIZE; i += 8)
+    {
+        for (size_t j = 0; j < 8; j++)
+        {
+            float diff = pA[i + j] - pB[i + j];
+            sums[j] += diff * diff;
+        }
+    }
+    return ((sums[0] + sums[4]) + (sums[1] + sums[5])) + ((sums[2] + sums[6]) + (sums[3] + sums[7]));
+}
+
 typedef struct
 {
     union {
@@ -482,10 +543,99 @@ typedef struct
 } WynnBuild;
 
 float wynnitem_similarity(WynnItem* pItem, WynnItem* pTestItem);
+void wynnitem_similarity_scan(WynnItem* pItem, WynnItemStatTable* pTable, float* pScoresOut);
+
+/// @brief The k items of the same slot closest to an item, by the distance wynnitem_similarity_scan
+//  scores. Looked up in a tree rebuilt with the stat tables, so it doesn't scan the whole slot.
+/// @param[in] pItem Query, it is its own closest item if it is in the slot
+/// @param k Items wanted
+/// @param[out] ppItemsOut Up to k items, closest first
+/// @param[out] pDistancesOut Distance of every item
+/// @return Items found, fewer than k if the slot is smaller
+size_t wynnitem_knn(WynnItem* pItem, size_t k, WynnItem** ppItemsOut, float* pDistancesOut);
+
+/// @brief About the k items of the same slot closest to an item, like wynnitem_knn but walked
+//  through a feature graph (see featuregraph.h), so now and then a close item is missed
+/// @param[in] pItem Query
+/// @param k Items wanted
+/// @param efSearch Candidates kept, FEATURE_GRAPH_EF_SEARCH by default, more finds more of the true k
+/// @param[out] ppItemsOut Up to k items, closest first
+/// @param[out] pDistancesOut Distance of every item
+/// @return Items found, 0 before wynnitems_graphs_init
+size_t wynnitem_ann(WynnItem* pItem, size_t k, size_t efSearch, WynnItem** ppItemsOut, float* pDistancesOut);
+
+/// @brief Loads the feature graphs of every slot from a cache file and builds the ones that are
+//  missing or stale on all cores, then writes the file back. After that they are rebuilt along
+//  with the stat tables.
+/// @param[in] cachePath Graph cache, kept next to the item cache
+/// @return FALSE if the cache couldn't be written
+bool wynnitems_graphs_init(char* cachePath);
+
+/// @brief Writes the feature graphs of every slot to a cache file
+/// @param[in] cachePath Graph cache
+/// @return FALSE before wynnitems_graphs_init
+bool wynnitems_graphs_save(char* cachePath);
+
+/// @brief Queries every item against its slot graph for a range of efSearch and prints the recall@k
+//  and time per query next to a brute force scan
+/// @param k Neighbours per query
+/// @return FALSE if the graphs aren't built
+bool wynnitems_graph_benchmark(size_t k);
+
+/// @brief The k items of the same slot closest to an item, read from the neighbours computed by
+//  wynnitems_neighbours_init, so it costs O(k). Same items and distances as wynnitem_knn.
+/// @param[in] pItem Query, its own closest item
+/// @param k Items wanted, at most FEATURE_MATRIX_K are kept
+/// @param[out] ppItemsOut Up to k items, closest first
+/// @param[out] pDistancesOut Distance of every item
+/// @return Items found, 0 before wynnitems_neighbours_init or if pItem isn't in its slot
+size_t wynnitem_neighbours(WynnItem* pItem, size_t k, WynnItem** ppItemsOut, float* pDistancesOut);
+
+/// @brief Loads the neighbours of every item from a cache file and computes the ones that are
+//  missing or stale with a blocked all pairs scan on all cores, then writes the file back.
+//  After that they are recomputed along with the stat tables.
+/// @param[in] cachePath Neighbour cache, kept next to the item cache
+/// @return FALSE if the cache couldn't be written
+bool wynnitems_neighbours_init(char* cachePath);
+
+/// @brief Writes the neighbours of every item to a cache file
+/// @param[in] cachePath Neighbour cache
+/// @return FALSE before wynnitems_neighbours_init
+bool wynnitems_neighbours_save(char* cachePath);
+
+/// @brief Hash of the features of a table, anything derived from them is stale once it changes
+uint64_t wynnitem_feature_fingerprint(WynnItemStatTable* pTable);
+
+/// @brief Scales raw stats the way the stat table features are
+/// @param[in] pStats WYNNITEM_ID_ARRAY_SIZE raw stat values
+/// @param[out] pFeaturesOut WYNNITEM_ID_ARRAY_SIZE features
+void wynnitem_features(const float* pStats, float* pFeaturesOut);
+
+/// @brief Features of an item, wynnitem_features of its stats
+/// @param[in] pItem Item
+/// @param[out] pFeaturesOut WYNNITEM_ID_ARRAY_SIZE features
+void wynnitem_item_features(WynnItem* pItem, float* pFeaturesOut);
+
+/// @brief Squared feature distance from a query to every row of a table
+/// @param[in] pTable Table
+/// @param[in] pFeatures Query from wynnitem_features
+/// @param[out] pDistancesOut One distance per row
+void wynnitem_feature_scan(WynnItemStatTable* pTable, const float* pFeatures, float* pDistancesOut);
+
+// Largest difference of a SIMD feature scan from the scalar one, relative to |q|^2 + |a|^2 + 1
+#define WYNNITEM_FEATURE_EPSILON 1e-5f
+
+/// @brief Times every feature scan kernel the cpu runs over all slots (each item against its slot)
+//  and checks them against the scalar kernel
+/// @param iterations Scans timed per query
+/// @return TRUE if every kernel is within WYNNITEM_FEATURE_EPSILON of the scalar one
+bool wynnitems_feature_benchmark(size_t iterations);
+WynnItemStatTable* wynnitem_stat_table(WynnItemType type);
 float wynnitem_get_value(size_t index);
 void wynnitem_set_value(size_t index, float value);
 
 void wynnitems_init(WynnItemList* pItemList);
+void wynnitems_update(WynnItemList* pRemoved, WynnItemList* pAdded);
 void wynnitems_cleanup();
 WynnBuild wynnitems_calculate_build(size_t numIters);
 #endif // WYNNBUILD_H
\ No newline at end of file
@@ -0,0 +1,264 @@
+// Generated by gen_keyhash.py from the name tables in wynnitems.h. Do not edit.
+#ifndef WYNNKEYHASH_H
+#define WYNNKEYHASH_H
+
+#include <stdint.h>
+
+struct wynnitem_keyhash_entry
+{
+    const char* key;
+    uint8_t length;
+    uint8_t index;
+};
+
+#define WYNNITEM_KEYHASH_REQS_BITS 5
+#define WYNNITEM_KEYHASH_REQS_SEED 0x811C9DC6u
+
+static const struct wynnitem_keyhash_entry wynnItemReqsKeyEntries[] = {
+    {"level", 5, 0},
+    {"strength", 8, 1},
+    {"dexterity", 9, 2},
+    {"defence", 7, 3},
+    {"agility", 7, 4},
+    {"intelligence", 12, 5},
+};
+
+// Slot to entry index + 1 (0 is an empty slot)
+static const uint8_t wynnItemReqsKeySlots[1 << WYNNITEM_KEYHASH_REQS_BITS] = {
+    [9] = 1,
+    [22] = 2,
+    [17] = 3,
+    [28] = 4,
+    [5] = 5,
+    [4] = 6,
+};
+
+#define WYNNITEM_KEYHASH_BASE_BITS 7
+#define WYNNITEM_KEYHASH_BASE_SEED 0x811C9DC9u
+
+static const struct wynnitem_keyhash_entry wynnItemBaseKeyEntries[] = {
+    {"averageDPS", 10, 6},
+    {"damage", 6, 7},
+    {"earthDamage", 11, 8},
+    {"thunderDamage", 13, 9},
+    {"fireDamage", 10, 10},
+    {"airDamage", 9, 11},
+    {"waterDamage", 11, 12},
+    {"health", 6, 13},
+    {"earthDefence", 12, 14},
+    {"thunderDefence", 14, 15},
+    {"fireDefence", 11, 16},
+    {"airDefence", 10, 17},
+    {"waterDefence", 12, 18},
+};
+
+// Slot to entry index + 1 (0 is an empty slot)
+static const uint8_t wynnItemBaseKeySlots[1 << WYNNITEM_KEYHASH_BASE_BITS] = {
+    [34] = 1,
+    [93] = 2,
+    [71] = 3,
+    [58] = 4,
+    [35] = 5,
+    [87] = 6,
+    [52] = 7,
+    [16] = 8,
+    [111] = 9,
+    [120] = 10,
+    [66] = 11,
+    [7] = 12,
+    [5] = 13,
+};
+
+#define WYNNITEM_KEYHASH_IDS_BITS 10
+#define WYNNITEM_KEYHASH_IDS_SEED 0x811C9E3Du
+
+static const struct wynnitem_keyhash_entry wynnItemIdsKeyEntries[] = {
+    {"rawAttackSpeed", 14, 19},
+    {"rawStrength", 11, 20},
+    {"rawDexterity", 12, 21},
+    {"rawDefence", 10, 22},
+    {"rawAgility", 10, 23},
+    {"rawIntelligence", 15, 24},
+    {"elementalDamage", 15, 25},
+    {"earthDamage", 11, 26},
+    {"thunderDamage", 13, 27},
+    {"fireDamage", 10, 28},
+    {"airDamage", 9, 29},
+    {"waterDamage", 11, 30},
+    {"elementalDefence", 16, 31},
+    {"earthDefence", 12, 32},
+    {"thunderDefence", 14, 33},
+    {"fireDefence", 11, 34},
+    {"airDefence", 10, 35},
+    {"waterDefence", 12, 36},
+    {"rawElementalDamage", 18, 37},
+    {"rawEarthDamage", 14, 38},
+    {"rawThunderDamage", 16, 39},
+    {"rawFireDamage", 13, 40},
+    {"rawAirDamage", 12, 41},
+    {"rawWaterDamage", 14, 42},
+    {"mainAttackDamage", 16, 43},
+    {"earthMainAttackDamage", 21, 44},
+    {"thunderMainAttackDamage", 23, 45},
+    {"fireMainAttackDamage", 20, 46},
+    {"airMainAttackDamage", 19, 47},
+    {"waterMainAttackDamage", 21, 48},
+    {"rawMainAttackDamage", 19, 49},
+    {"rawElementalMainAttackDamage", 28, 50},
+    {"rawEarthMainAttackDamage", 24, 51},
+    {"rawThunderMainAttackDamage", 26, 52},
+    {"rawFireMainAttackDamage", 23, 53},
+    {"rawAirMainAttackDamage", 22, 54},
+    {"rawWaterMainAttackDamage", 24, 55},
+    {"spellDamage", 11, 56},
+    {"elementalSpellDamage", 20, 57},
+    {"earthSpellDamage", 16, 58},
+    {"thunderSpellDamage", 18, 59},
+    {"fireSpellDamage", 15, 60},
+    {"airSpellDamage", 14, 61},
+    {"waterSpellDamage", 16, 62},
+    {"rawSpellDamage", 14, 63},
+    {"rawNeutralSpellDamage", 21, 64},
+    {"rawElementalSpellDamage", 23, 65},
+    {"rawEarthSpellDamage", 19, 66},
+    {"rawThunderSpellDamage", 21, 67},
+    {"rawFireSpellDamage", 18, 68},
+    {"rawAirSpellDamage", 17, 69},
+    {"rawWaterSpellDamage", 19, 70},
+    {"healing", 7, 71},
+    {"rawHealth", 9, 72},
+    {"healingEfficiency", 17, 73},
+    {"healthRegen", 11, 74},
+    {"healthRegenRaw", 14, 75},
+    {"lifeSteal", 9, 76},
+    {"manaRegen", 9, 77},
+    {"manaSteal", 9, 78},
+    {"sprint", 6, 79},
+    {"sprintRegen", 11, 80},
+    {"walkSpeed", 9, 81},
+    {"jumpHeight", 10, 82},
+    {"thorns", 6, 83},
+    {"reflection", 10, 84},
+    {"knockback", 9, 85},
+    {"exploding", 9, 86},
+    {"poison", 6, 87},
+    {"stealing", 8, 88},
+    {"xpBonus", 7, 89},
+    {"lootBonus", 9, 90},
+    {"soulPointRegen", 14, 91},
+    {"spellCost1st", 12, 92},
+    {"spellCost2nd", 12, 93},
+    {"spellCost3rd", 12, 94},
+    {"spellCost4th", 12, 95},
+    {"rawSpellCost1st", 15, 96},
+    {"rawSpellCost2nd", 15, 97},
+    {"rawSpellCost3rd", 15, 98},
+    {"rawSpellCost4th", 15, 99},
+    {"slowEnemy", 9, 100},
+    {"weakenEnemy", 11, 101},
+    {"1stSpellCost", 12, 92},
+    {"2ndSpellCost", 12, 93},
+    {"3rdSpellCost", 12, 94},
+    {"4thSpellCost", 12, 95},
+    {"raw1stSpellCost", 15, 96},
+    {"raw2ndSpellCost", 15, 97},
+    {"raw3rdSpellCost", 15, 98},
+    {"raw4thSpellCost", 15, 99},
+};
+
+// Slot to entry index + 1 (0 is an empty slot)
+static const uint8_t wynnItemIdsKeySlots[1 << WYNNITEM_KEYHASH_IDS_BITS] = {
+    [641] = 1,
+    [965] = 2,
+    [241] = 3,
+    [637] = 4,
+    [268] = 5,
+    [13] = 6,
+    [808] = 7,
+    [35] = 8,
+    [168] = 9,
+    [244] = 10,
+    [431] = 11,
+    [415] = 12,
+    [776] = 13,
+    [703] = 14,
+    [445] = 15,
+    [171] = 16,
+    [693] = 17,
+    [302] = 18,
+    [572] = 19,
+    [158] = 20,
+    [164] = 21,
+    [611] = 22,
+    [450] = 23,
+    [652] = 24,
+    [623] = 25,
+    [683] = 26,
+    [117] = 27,
+    [356] = 28,
+    [432] = 29,
+    [169] = 30,
+    [467] = 31,
+    [935] = 32,
+    [190] = 33,
+    [879] = 34,
+    [245] = 35,
+    [852] = 36,
+    [597] = 37,
+    [81] = 38,
+    [860] = 39,
+    [311] = 40,
+    [695] = 41,
+    [709] = 42,
+    [838] = 43,
+    [423] = 44,
+    [904] = 45,
+    [950] = 46,
+    [843] = 47,
+    [872] = 48,
+    [93] = 49,
+    [198] = 50,
+    [869] = 51,
+    [889] = 52,
+    [107] = 53,
+    [857] = 54,
+    [167] = 55,
+    [258] = 56,
+    [882] = 57,
+    [414] = 58,
+    [992] = 59,
+    [676] = 60,
+    [999] = 61,
+    [354] = 62,
+    [556] = 63,
+    [903] = 64,
+    [97] = 65,
+    [723] = 66,
+    [63] = 67,
+    [299] = 68,
+    [170] = 69,
+    [971] = 70,
+    [143] = 71,
+    [986] = 72,
+    [761] = 73,
+    [619] = 74,
+    [492] = 75,
+    [1009] = 76,
+    [604] = 77,
+    [675] = 78,
+    [769] = 79,
+    [133] = 80,
+    [91] = 81,
+    [494] = 82,
+    [236] = 83,
+    [439] = 84,
+    [106] = 85,
+    [454] = 86,
+    [739] = 87,
+    [434] = 88,
+    [281] = 89,
+    [983] = 90,
+    [340] = 91,
+};
+
+#endif // WYNNKEYHASH_H